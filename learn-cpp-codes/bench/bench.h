@@ -0,0 +1,485 @@
+/**
+ * @file:	bench.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/18 02:00:00 Sunday
+ * @brief:	statistical microbenchmark harness shared by the examples
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "counters.h"
+
+// One run timed once mostly measures noise: a cold cache, a frequency ramp,
+// an interrupt. `measure(f)` instead
+//
+// 1. runs `f` for a warmup period,
+// 2. calibrates a number of iterations so that one sample lasts at least
+//    `min_sample` seconds, well above the clock resolution,
+// 3. takes `samples` samples of that many iterations,
+//
+// and summarizes the time per iteration by its median, the median absolute
+// deviation (MAD) around it and the 99th percentile. The median and the MAD
+// are robust: a few disturbed samples move the p99, not them. With
+// `counters`, the samples are also counted by the hardware counters of
+// counters.h, to tell why a time changed: instructions per cycle, cache and
+// branch misses, page faults.
+//
+// Benchmarks registered with `BENCHMARK` are run by `bench::run`, the `main`
+// of every benchmark program, and all programs by the `bench` CMake target:
+//
+//   BENCHMARK_ELEMENTS(std_sort, input.size())
+//   {
+//     auto copy = input;
+//     std::sort(copy.begin(), copy.end());
+//     bench::do_not_optimize(copy);
+//   }
+//
+//   int main(int argc, char** argv) { return bench::run(argc, argv); }
+//
+// The body is one iteration; setup written inside it is timed with it.
+// Counts are reported per element, an iteration being `elements` of them (1
+// with `BENCHMARK`).
+
+namespace bench
+{
+
+// ================================================================================================
+// Clock and barriers
+// ================================================================================================
+
+class Timer
+{
+private:
+  using Clock = std::chrono::steady_clock;
+  using Second = std::chrono::duration<double, std::ratio<1>>;
+
+  std::chrono::time_point<Clock> m_beg{Clock::now()};
+
+public:
+  void reset() { m_beg = Clock::now(); }
+
+  double elapsed() const
+  {
+    return std::chrono::duration_cast<Second>(Clock::now() - m_beg).count();
+  }
+};
+
+// `do_not_optimize(x)` makes the compiler assume `x` is read (and, for an
+// lvalue, modified) here, so the computation of `x` cannot be dropped or
+// hoisted out of the timed loop. `clobber_memory()` makes it assume all
+// memory is read and written, so pending stores have to happen before. Both
+// cost no instruction (the DoNotOptimize / ClobberMemory of Google
+// Benchmark).
+#if defined(__GNUC__) || defined(__clang__)
+
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename T>
+inline void do_not_optimize(T& value)
+{
+#if defined(__clang__)
+  asm volatile("" : "+r,m"(value) : : "memory");
+#else
+  asm volatile("" : "+m,r"(value) : : "memory");
+#endif
+}
+
+inline void clobber_memory() { asm volatile("" : : : "memory"); }
+
+#else
+
+namespace detail
+{
+inline void use(void const volatile*) {}
+} // namespace detail
+
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+  detail::use(&value);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+inline void clobber_memory()
+{
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+#endif
+
+// ================================================================================================
+// Measurement
+// ================================================================================================
+
+struct Options
+{
+  double warmup = 0.1;      // seconds
+  double min_sample = 0.01; // seconds per sample, at least
+  size_t samples = 50;
+  bool counters = false; // count the samples with `Counters`
+};
+
+// seconds per iteration
+struct Stats
+{
+  size_t iterations = 0; // per sample
+  size_t samples = 0;
+  double median = 0.0;
+  double mad = 0.0;
+  double p99 = 0.0;
+  double min = 0.0;
+  double mean = 0.0;
+  Counts counts; // per iteration, with `Options::counters`
+};
+
+namespace detail
+{
+
+// linear interpolation between the closest ranks of a sorted sample
+inline double quantile(std::vector<double> const& sorted, double q)
+{
+  double pos = q * static_cast<double>(sorted.size() - 1);
+  size_t lo = static_cast<size_t>(pos);
+  size_t hi = std::min(lo + 1, sorted.size() - 1);
+  return sorted[lo] + (pos - static_cast<double>(lo)) * (sorted[hi] - sorted[lo]);
+}
+
+} // namespace detail
+
+inline Stats summarize(std::vector<double> per_iteration, size_t iterations)
+{
+  Stats s;
+  s.iterations = iterations;
+  s.samples = per_iteration.size();
+  if (per_iteration.empty())
+    return s;
+
+  std::sort(per_iteration.begin(), per_iteration.end());
+  s.median = detail::quantile(per_iteration, 0.5);
+  s.p99 = detail::quantile(per_iteration, 0.99);
+  s.min = per_iteration.front();
+  double sum = 0.0;
+  for (double t : per_iteration)
+    sum += t;
+  s.mean = sum / static_cast<double>(per_iteration.size());
+
+  std::vector<double> deviation;
+  deviation.reserve(per_iteration.size());
+  for (double t : per_iteration)
+    deviation.push_back(std::fabs(t - s.median));
+  std::sort(deviation.begin(), deviation.end());
+  s.mad = detail::quantile(deviation, 0.5);
+  return s;
+}
+
+template <typename F>
+Stats measure(F&& f, Options const& opt = {})
+{
+  auto run = [&](size_t n) {
+    Timer t;
+    for (size_t i = 0; i < n; ++i)
+    {
+      f();
+      clobber_memory();
+    }
+    return t.elapsed();
+  };
+
+  // warmup, which also gives a first estimate of the time per iteration
+  Timer warm;
+  size_t done = 0;
+  do
+  {
+    run(1);
+    ++done;
+  } while (warm.elapsed() < opt.warmup);
+  // at least a nanosecond: a clock that did not tick would divide by zero
+  double const estimate =
+      std::max(warm.elapsed() / static_cast<double>(done), 1e-9);
+
+  // calibration: grow `n` until a sample is long enough
+  double const guess = opt.min_sample / estimate;
+  size_t n = 1;
+  if (std::isfinite(guess) && guess > 1.0)
+    n = static_cast<size_t>(std::min(guess, 1e12));
+  while (run(n) < opt.min_sample)
+    n *= 2;
+
+  // the counters are started and stopped outside of the timed loop
+  std::optional<Counters> counters;
+  if (opt.counters)
+    counters.emplace();
+  Counts counts;
+
+  std::vector<double> per_iteration;
+  per_iteration.reserve(opt.samples);
+  for (size_t s = 0; s < opt.samples; ++s)
+  {
+    if (counters)
+      counters->start();
+    double t = run(n);
+    if (counters)
+      counts += counters->stop();
+    per_iteration.push_back(t / static_cast<double>(n));
+  }
+
+  Stats stats = summarize(std::move(per_iteration), n);
+  stats.counts = counts /= static_cast<double>(n * opt.samples);
+  return stats;
+}
+
+// ================================================================================================
+// Registry and runner
+// ================================================================================================
+
+struct Benchmark
+{
+  std::string name;
+  std::function<void()> body;
+  double elements = 1.0; // per iteration
+};
+
+inline std::vector<Benchmark>& registry()
+{
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+struct Registrar
+{
+  Registrar(char const* name, void (*body)(), double elements = 1.0)
+  {
+    registry().push_back({name, body, elements});
+  }
+};
+
+#define BENCHMARK_ELEMENTS(name, elements)                                     \
+  static void bench_##name();                                                  \
+  static ::bench::Registrar const bench_registrar_##name{                      \
+      #name, bench_##name, static_cast<double>(elements)                       \
+  };                                                                           \
+  static void bench_##name()
+
+#define BENCHMARK(name) BENCHMARK_ELEMENTS(name, 1)
+
+namespace detail
+{
+
+// `1.23 ms`
+inline std::string human(double seconds)
+{
+  static constexpr std::pair<double, char const*> units[] = {
+      {1.0, "s"}, {1e-3, "ms"}, {1e-6, "us"}, {1e-9, "ns"}
+  };
+  for (auto [scale, unit] : units)
+    if (seconds >= scale || scale == 1e-9)
+    {
+      std::ostringstream os;
+      os << std::fixed << std::setprecision(seconds / scale < 100 ? 2 : 1)
+         << seconds / scale << ' ' << unit;
+      return os.str();
+    }
+  return {};
+}
+
+// a count per element, `-` when not counted
+inline std::string count(double v)
+{
+  if (std::isnan(v))
+    return "-";
+  std::ostringstream os;
+  if (v < 100)
+    os << std::setprecision(3) << v;
+  else
+    os << std::fixed << std::setprecision(0) << v;
+  return os.str();
+}
+
+inline bool starts_with(std::string_view s, std::string_view prefix)
+{
+  return s.substr(0, prefix.size()) == prefix;
+}
+
+} // namespace detail
+
+// usage: <program> [--format=table|csv|json] [--filter=substring]
+//                  [--samples=n] [--min-sample=seconds] [--warmup=seconds]
+//                  [--counters]
+inline int run(int argc, char** argv)
+{
+  Options opt;
+  std::string format = "table", filter;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string_view a = argv[i];
+    auto value = [&] { return std::string(a.substr(a.find('=') + 1)); };
+    if (detail::starts_with(a, "--format="))
+      format = value();
+    else if (detail::starts_with(a, "--filter="))
+      filter = value();
+    else if (detail::starts_with(a, "--samples="))
+      opt.samples =
+          std::max<size_t>(1, std::strtoull(value().c_str(), nullptr, 10));
+    else if (detail::starts_with(a, "--min-sample="))
+      opt.min_sample = std::atof(value().c_str());
+    else if (detail::starts_with(a, "--warmup="))
+      opt.warmup = std::atof(value().c_str());
+    else if (a == "--counters")
+      opt.counters = true;
+    else
+    {
+      std::cerr << "unknown argument " << a << '\n';
+      return 2;
+    }
+  }
+
+  // per element of the counted events, then instructions per cycle
+  static constexpr std::pair<Event, char const*> counted[] = {
+      {Event::cycles, "cycles"},
+      {Event::l1d_misses, "l1d_misses"},
+      {Event::llc_misses, "llc_misses"},
+      {Event::branch_misses, "branch_misses"},
+      {Event::page_faults, "page_faults"},
+  };
+
+  if (opt.counters)
+  {
+    // on stderr, to keep CSV and JSON on stdout parsable
+    Counters probe;
+    std::string missing;
+    for (size_t e = 0; e < event_count; ++e)
+      if (!probe.available(static_cast<Event>(e)))
+        missing += std::string(missing.empty() ? "" : ", ") + event_names[e];
+    if (!missing.empty())
+      std::cerr << "not counted: " << missing
+                << " (no PMU, or perf_event_paranoid too high)\n";
+  }
+
+  if (format == "csv")
+  {
+    std::cout << "name,iterations,samples,median_ns,mad_ns,p99_ns,min_ns,"
+                 "mean_ns";
+    if (opt.counters)
+    {
+      std::cout << ",elements,ipc";
+      for (auto [e, name] : counted)
+        std::cout << ',' << name << "_per_element";
+    }
+    std::cout << '\n';
+  }
+  else if (format == "json")
+    std::cout << "[";
+  else
+  {
+    std::cout << std::left << std::setw(28) << "benchmark" << std::right
+              << std::setw(12) << "median" << std::setw(12) << "MAD"
+              << std::setw(8) << "MAD %" << std::setw(12) << "p99"
+              << std::setw(12) << "iterations" << std::setw(9) << "samples";
+    if (opt.counters)
+      std::cout << std::setw(7) << "IPC" << std::setw(10) << "cyc/el"
+                << std::setw(10) << "L1d/el" << std::setw(10) << "LLC/el"
+                << std::setw(10) << "br/el" << std::setw(10) << "flt/el";
+    std::cout << '\n';
+  }
+
+  char const* separator = "\n";
+  for (auto const& b : registry())
+  {
+    if (b.name.find(filter) == std::string::npos)
+      continue;
+    Stats s = measure(b.body, opt);
+    auto per_element = [&](Event e) { return s.counts[e] / b.elements; };
+
+    if (format == "csv" || format == "json")
+    {
+      // a count not counted is an empty CSV field, a JSON null
+      auto number = [&](double v) {
+        std::ostringstream os;
+        os << std::setprecision(6);
+        if (!std::isnan(v))
+          os << v;
+        else if (format == "json")
+          os << "null";
+        return os.str();
+      };
+
+      std::ostringstream os;
+      os << std::setprecision(6);
+      if (format == "csv")
+      {
+        os << b.name << ',' << s.iterations << ',' << s.samples << ','
+           << s.median * 1e9 << ',' << s.mad * 1e9 << ',' << s.p99 * 1e9 << ','
+           << s.min * 1e9 << ',' << s.mean * 1e9;
+        if (opt.counters)
+        {
+          os << ',' << b.elements << ',' << number(s.counts.ipc());
+          for (auto [e, name] : counted)
+            os << ',' << number(per_element(e));
+        }
+        os << '\n';
+      }
+      else
+      {
+        os << separator << "  {\"name\": \"" << b.name
+           << "\", \"iterations\": " << s.iterations
+           << ", \"samples\": " << s.samples
+           << ", \"median_ns\": " << s.median * 1e9
+           << ", \"mad_ns\": " << s.mad * 1e9 << ", \"p99_ns\": " << s.p99 * 1e9
+           << ", \"min_ns\": " << s.min * 1e9
+           << ", \"mean_ns\": " << s.mean * 1e9;
+        if (opt.counters)
+        {
+          os << ", \"elements\": " << b.elements
+             << ", \"ipc\": " << number(s.counts.ipc());
+          for (auto [e, name] : counted)
+            os << ", \"" << name << "_per_element\": " << number(per_element(e));
+        }
+        os << "}";
+      }
+      std::cout << os.str() << std::flush;
+      separator = ",\n";
+    }
+    else
+    {
+      std::cout << std::left << std::setw(28) << b.name << std::right
+                << std::setw(12) << detail::human(s.median) << std::setw(12)
+                << detail::human(s.mad) << std::setw(7) << std::fixed
+                << std::setprecision(1) << 100.0 * s.mad / s.median << '%'
+                << std::setw(12) << detail::human(s.p99) << std::setw(12)
+                << s.iterations << std::setw(9) << s.samples;
+      if (opt.counters)
+      {
+        std::cout << std::setw(7) << detail::count(s.counts.ipc());
+        for (auto [e, name] : counted)
+          std::cout << std::setw(10) << detail::count(per_element(e));
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  if (format == "json")
+    std::cout << "\n]\n";
+  return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,217 @@
+/**
+ * @file:	counters.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/18 02:40:00 Sunday
+ * @brief:	hardware performance counters around a timed region
+ **/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// A time says that code got slower, not why. `Counters` opens Linux
+// `perf_event_open` counters for the calling thread, in user space, and reads
+// them around a region:
+//
+//   bench::Counters counters;
+//   counters.start();
+//   run();
+//   bench::Counts c = counters.stop();
+//   double ipc = c.ipc();
+//
+// Each event is opened on its own, so that a missing one does not take the
+// others with it; the kernel multiplexes them when there are more events
+// than hardware counters, and counts are scaled by the time each one ran.
+// Events that cannot be opened (no PMU in a VM or container,
+// perf_event_paranoid > 2, not Linux) are left out: `Counts::has` is false
+// for them and the region is still timed. Page faults are a software event,
+// and fall back to `getrusage` when even those are forbidden.
+//
+// Threads started inside the region are not counted.
+
+namespace bench
+{
+
+enum class Event : size_t
+{
+  cycles,
+  instructions,
+  l1d_misses,
+  llc_misses,
+  branch_misses,
+  page_faults,
+};
+
+inline constexpr size_t event_count = 6;
+
+inline constexpr char const* event_names[event_count] = {
+    "cycles",     "instructions",  "L1d misses",
+    "LLC misses", "branch misses", "page faults",
+};
+
+struct Counts
+{
+  std::array<double, event_count> value{};
+  std::array<bool, event_count> counted{};
+
+  bool has(Event e) const { return counted[static_cast<size_t>(e)]; }
+
+  // NaN when not counted
+  double operator[](Event e) const
+  {
+    return has(e) ? value[static_cast<size_t>(e)] : NAN;
+  }
+
+  // instructions per cycle
+  double ipc() const
+  {
+    return (*this)[Event::instructions] / (*this)[Event::cycles];
+  }
+
+  Counts& operator+=(Counts const& other)
+  {
+    for (size_t i = 0; i < event_count; ++i)
+    {
+      value[i] += other.value[i];
+      counted[i] = counted[i] || other.counted[i];
+    }
+    return *this;
+  }
+
+  Counts& operator/=(double n)
+  {
+    for (double& v : value)
+      v /= n;
+    return *this;
+  }
+};
+
+class Counters
+{
+  std::array<int, event_count> m_fd;
+  bool m_rusage_faults = false;
+  long m_faults_at_start = 0;
+
+#ifdef __linux__
+  static int open(uint32_t type, uint64_t config)
+  {
+    perf_event_attr attr{};
+    attr.type = type;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  static long thread_faults()
+  {
+    rusage u{};
+    getrusage(RUSAGE_THREAD, &u);
+    return u.ru_minflt + u.ru_majflt;
+  }
+#endif
+
+public:
+  Counters()
+  {
+    m_fd.fill(-1);
+#ifdef __linux__
+    constexpr uint64_t l1d_read_miss =
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    // in the order of `Event`
+    m_fd[0] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    m_fd[1] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    m_fd[2] = open(PERF_TYPE_HW_CACHE, l1d_read_miss);
+    // the generic cache miss event, the last level cache on x86
+    m_fd[3] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    m_fd[4] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    m_fd[5] = open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    m_rusage_faults = m_fd[5] < 0;
+#endif
+  }
+
+  Counters(Counters const&) = delete;
+  Counters& operator=(Counters const&) = delete;
+
+  ~Counters()
+  {
+#ifdef __linux__
+    for (int fd : m_fd)
+      if (fd >= 0)
+        close(fd);
+#endif
+  }
+
+  bool available(Event e) const
+  {
+    return m_fd[static_cast<size_t>(e)] >= 0 ||
+           (e == Event::page_faults && m_rusage_faults);
+  }
+
+  // cycles or instructions, i.e. a PMU
+  bool hardware() const
+  {
+    return available(Event::cycles) || available(Event::instructions);
+  }
+
+  void start()
+  {
+#ifdef __linux__
+    if (m_rusage_faults)
+      m_faults_at_start = thread_faults();
+    for (int fd : m_fd)
+      if (fd >= 0)
+      {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+  }
+
+  Counts stop()
+  {
+    Counts c;
+#ifdef __linux__
+    for (int fd : m_fd)
+      if (fd >= 0)
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    for (size_t i = 0; i < event_count; ++i)
+    {
+      // value, time enabled, time running
+      uint64_t r[3];
+      if (m_fd[i] < 0 || read(m_fd[i], r, sizeof(r)) != sizeof(r) || r[2] == 0)
+        continue;
+      c.value[i] = static_cast<double>(r[0]) * static_cast<double>(r[1]) /
+                   static_cast<double>(r[2]);
+      c.counted[i] = true;
+    }
+
+    if (m_rusage_faults)
+    {
+      auto const faults = static_cast<size_t>(Event::page_faults);
+      c.value[faults] = static_cast<double>(thread_faults() - m_faults_at_start);
+      c.counted[faults] = true;
+    }
+#endif
+    return c;
+  }
+};
+
+} // namespace bench
@@ -0,0 +1,314 @@
+/**
+ * @file:	dispatch_bench.cpp
+ * @author:	Jacob Xie
+ * @date:	2026/10/18 01:20:00 Sunday
+ * @brief:	cost of a call through CRTP, virtual, variant and function tables
+ **/
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "bench/bench.h"
+
+// The same workload, the sum of the areas of a sequence of circles, squares
+// and triangles, with the call to `area` dispatched four ways:
+//
+// - crtp:     `Shape<D>::area()` (main.cpp, section 1). Static polymorphism
+//             has no common type to put in one sequence, so the shapes are
+//             kept in one array per type and each array is a direct,
+//             inlined loop; the order of the sequence is lost on the way
+// - virtual:  `VShape::area()`, through pointers in sequence order, like
+//             `Shape::print` of virtual_quiz
+// - variant:  `std::variant` of the three and `std::visit`
+// - table:    a kind byte indexing an array of function pointers (fn_ptr)
+//
+// over three orders of the same shapes:
+//
+// - same:    one type only, the best case for every predictor
+// - sorted:  grouped by type, one misprediction per group change
+// - random:  types drawn at random, the indirect branch (or the switch of
+//            `std::visit`) is mispredicted about 2 times in 3
+//
+// Branch misses come from the hardware counters of bench/counters.h and show
+// "-" where they are not available (no PMU in a VM, perf_event_paranoid > 2).
+
+// ================================================================================================
+// The shapes, once per mechanism
+// ================================================================================================
+
+enum Kind : uint8_t
+{
+  circle,
+  square,
+  triangle,
+};
+
+struct Params
+{
+  Kind kind;
+  double x, y;
+};
+
+// crtp, also the alternatives of the variant
+template <typename Derived>
+struct Shape
+{
+  double area() const
+  {
+    return static_cast<Derived const*>(this)->area_impl();
+  }
+};
+
+struct Circle : Shape<Circle>
+{
+  double r;
+  double area_impl() const { return 3.141592653589793 * r * r; }
+};
+
+struct Square : Shape<Square>
+{
+  double a;
+  double area_impl() const { return a * a; }
+};
+
+struct Triangle : Shape<Triangle>
+{
+  double b, h;
+  double area_impl() const { return 0.5 * b * h; }
+};
+
+// virtual
+struct VShape
+{
+  virtual ~VShape() = default;
+  virtual double area() const = 0;
+};
+
+struct VCircle final : VShape
+{
+  double r;
+  explicit VCircle(double r) : r{r} {}
+  double area() const override { return 3.141592653589793 * r * r; }
+};
+
+struct VSquare final : VShape
+{
+  double a;
+  explicit VSquare(double a) : a{a} {}
+  double area() const override { return a * a; }
+};
+
+struct VTriangle final : VShape
+{
+  double b, h;
+  VTriangle(double b, double h) : b{b}, h{h} {}
+  double area() const override { return 0.5 * b * h; }
+};
+
+// variant
+using AnyShape = std::variant<Circle, Square, Triangle>;
+
+// function table
+struct Tagged
+{
+  Kind kind;
+  double x, y;
+};
+
+double circle_area(Tagged const& t) { return 3.141592653589793 * t.x * t.x; }
+double square_area(Tagged const& t) { return t.x * t.x; }
+double triangle_area(Tagged const& t) { return 0.5 * t.x * t.y; }
+
+using AreaFn = double (*)(Tagged const&);
+constexpr std::array<AreaFn, 3> area_table{circle_area, square_area, triangle_area};
+
+// ================================================================================================
+// Cases
+// ================================================================================================
+
+struct Workload
+{
+  std::vector<Circle> circles;
+  std::vector<Square> squares;
+  std::vector<Triangle> triangles;
+
+  std::vector<std::unique_ptr<VShape>> owned;
+  std::vector<VShape const*> virtuals;
+
+  std::vector<AnyShape> variants;
+  std::vector<Tagged> tagged;
+
+  explicit Workload(std::vector<Params> const& shapes)
+  {
+    for (auto const& p : shapes)
+    {
+      switch (p.kind)
+      {
+      case circle:
+        circles.push_back(Circle{{}, p.x});
+        owned.push_back(std::make_unique<VCircle>(p.x));
+        variants.emplace_back(Circle{{}, p.x});
+        break;
+      case square:
+        squares.push_back(Square{{}, p.x});
+        owned.push_back(std::make_unique<VSquare>(p.x));
+        variants.emplace_back(Square{{}, p.x});
+        break;
+      case triangle:
+        triangles.push_back(Triangle{{}, p.x, p.y});
+        owned.push_back(std::make_unique<VTriangle>(p.x, p.y));
+        variants.emplace_back(Triangle{{}, p.x, p.y});
+        break;
+      }
+      virtuals.push_back(owned.back().get());
+      tagged.push_back(Tagged{p.kind, p.x, p.y});
+    }
+  }
+};
+
+template <typename T>
+double sum_crtp(std::vector<T> const& shapes)
+{
+  double s = 0.0;
+  for (auto const& x : shapes)
+    s += static_cast<Shape<T> const&>(x).area();
+  return s;
+}
+
+double pass_crtp(Workload const& w)
+{
+  return sum_crtp(w.circles) + sum_crtp(w.squares) + sum_crtp(w.triangles);
+}
+
+double pass_virtual(Workload const& w)
+{
+  double s = 0.0;
+  for (VShape const* x : w.virtuals)
+    s += x->area();
+  return s;
+}
+
+double pass_variant(Workload const& w)
+{
+  double s = 0.0;
+  for (auto const& x : w.variants)
+    s += std::visit([](auto const& shape) { return shape.area(); }, x);
+  return s;
+}
+
+double pass_table(Workload const& w)
+{
+  double s = 0.0;
+  for (auto const& x : w.tagged)
+    s += area_table[x.kind](x);
+  return s;
+}
+
+double checksum = 0.0;
+
+struct Result
+{
+  double ns_per_call;
+  double misses_per_call; // < 0 when not counted
+};
+
+// As many passes over `w` as make `calls`, one pass per sample, after one
+// that warms the caches and the predictors
+Result measure(double (*pass)(Workload const&), Workload const& w, size_t calls)
+{
+  size_t const length = w.tagged.size();
+  bench::Options opt;
+  opt.warmup = 0.0;
+  opt.min_sample = 0.0;
+  opt.samples = std::max<size_t>(1, calls / length);
+  opt.counters = true;
+  bench::Stats s = bench::measure([&] { checksum += pass(w); }, opt);
+  double const n = static_cast<double>(length);
+  return {
+      s.median * 1e9 / n,
+      s.counts.has(bench::Event::branch_misses)
+          ? s.counts[bench::Event::branch_misses] / n
+          : -1.0
+  };
+}
+
+std::vector<Params> make_shapes(std::string const& order, size_t n)
+{
+  std::mt19937_64 rng{7};
+  std::uniform_real_distribution<double> size(0.5, 2.0);
+  std::uniform_int_distribution<int> kind(0, 2);
+
+  std::vector<Params> shapes(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    Kind k = order == "same" ? circle
+             : order == "sorted"
+                 ? static_cast<Kind>(i * 3 / n)
+                 : static_cast<Kind>(kind(rng));
+    shapes[i] = Params{k, size(rng), size(rng)};
+  }
+  return shapes;
+}
+
+// usage: crtp_dispatch_bench [max calls] [sequence length]
+int main(int argc, char** argv)
+{
+  size_t const max_calls =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000;
+  size_t const max_length =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : size_t{1} << 20;
+
+  bench::Counters const counters; // to tell whether there is a PMU
+  struct Mechanism
+  {
+    char const* name;
+    double (*pass)(Workload const&);
+  };
+  Mechanism const mechanisms[] = {
+      {"crtp", pass_crtp},
+      {"virtual", pass_virtual},
+      {"variant", pass_variant},
+      {"table", pass_table},
+  };
+
+  std::cout << "ns/call (branch misses/call)"
+            << (counters.available(bench::Event::branch_misses)
+                    ? ""
+                    : ", no branch miss counter") << '\n'
+            << std::setw(8) << "order" << std::setw(11) << "calls";
+  for (auto const& m : mechanisms)
+    std::cout << std::setw(17) << m.name;
+  std::cout << '\n' << std::fixed;
+
+  for (std::string order : {"same", "sorted", "random"})
+    for (size_t calls = 1000000; calls <= max_calls; calls *= 10)
+    {
+      // a sequence much longer than the history of the branch predictor
+      // is repeated to reach the number of calls
+      Workload const w(make_shapes(order, std::min(calls, max_length)));
+      std::cout << std::setw(8) << order << std::setw(11) << calls;
+      for (auto const& m : mechanisms)
+      {
+        Result r = measure(m.pass, w, calls);
+        std::cout << std::setw(9) << std::setprecision(2) << r.ns_per_call;
+        if (r.misses_per_call >= 0)
+          std::cout << " (" << std::setprecision(3) << r.misses_per_call << ")";
+        else
+          std::cout << " (    -)";
+      }
+      std::cout << '\n';
+    }
+
+  std::cout << "checksum " << checksum << '\n';
+  return 0;
+}
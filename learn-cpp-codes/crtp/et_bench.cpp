@@ -0,0 +1,180 @@
+/**
+ * @file:	et_bench.cpp
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 20:20:00 Saturday
+ * @brief:	expression templates vs temporaries vs a hand-written fused loop
+ **/
+
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "bench/bench.h"
+#include "et_vec.h"
+
+// Every case sums `D` vectors of length `n` into an existing output,
+// `out = v0 + v1 + ... + v(D-1)`, in three ways:
+//
+// - et:   `Vec` expression templates, one fused pass, no allocation
+// - tmp:  classic operator overloading, every `+` returns a new vector
+// - hand: a plain loop over raw pointers, what the other two should match
+//
+// Effective GB/s counts the minimum traffic of `D` reads and one write per
+// element; `tmp` moves more than that, which is the point. Where the inputs
+// stop fitting in L1, L2 and the LLC shows up as steps in ns/element.
+
+// ================================================================================================
+// Baseline: operator overloading with temporaries
+// ================================================================================================
+
+struct TmpVec
+{
+  std::vector<double> elems;
+
+  explicit TmpVec(size_t n, double value = 0.0) : elems(n, value) {}
+};
+
+TmpVec operator+(TmpVec const& a, TmpVec const& b)
+{
+  TmpVec r(a.elems.size());
+  for (size_t i = 0; i < r.elems.size(); ++i)
+    r.elems[i] = a.elems[i] + b.elems[i];
+  return r;
+}
+
+// ================================================================================================
+// Cases
+// ================================================================================================
+
+template <size_t... I>
+void sum_et(
+    et::Vec& out, std::vector<et::Vec> const& v, std::index_sequence<I...>
+)
+{
+  out = (... + v[I]);
+}
+
+template <size_t... I>
+void sum_tmp(
+    TmpVec& out, std::vector<TmpVec> const& v, std::index_sequence<I...>
+)
+{
+  out = (... + v[I]);
+}
+
+template <size_t... I>
+void sum_hand(
+    double* __restrict out, double const* const* p, size_t n,
+    std::index_sequence<I...>
+)
+{
+  double const* __restrict q[] = {p[I]...};
+  for (size_t i = 0; i < n; ++i)
+    out[i] = (... + q[I][i]);
+}
+
+// Median seconds per run, over samples of at least `min_seconds` each. The
+// first run warms the caches and pages in the output.
+template <typename F>
+double time_per_run(F&& f, double min_seconds)
+{
+  bench::Options opt;
+  opt.warmup = 0.0;
+  opt.min_sample = min_seconds;
+  opt.samples = 5;
+  return bench::measure(f, opt).median;
+}
+
+double checksum = 0; // keeps the results observable
+
+void report(double seconds, size_t n, size_t depth)
+{
+  double const elements = static_cast<double>(n);
+  double const bytes =
+      elements * static_cast<double>((depth + 1) * sizeof(double));
+  std::cout << std::setw(9) << seconds * 1e9 / elements << std::setw(8)
+            << bytes / seconds * 1e-9;
+}
+
+template <size_t D>
+void run_case(size_t n, double min_seconds)
+{
+  std::vector<et::Vec> v;
+  std::vector<TmpVec> t;
+  std::vector<double const*> p;
+  for (size_t k = 0; k < D; ++k)
+  {
+    v.emplace_back(n, 1.0 + k);
+    t.emplace_back(n, 1.0 + k);
+  }
+  for (auto const& x : v)
+    p.push_back(x.data());
+
+  constexpr auto seq = std::make_index_sequence<D>{};
+  std::cout << std::setw(11) << n << std::setw(6) << D;
+
+  {
+    et::Vec out(n);
+    report(time_per_run([&] { sum_et(out, v, seq); }, min_seconds), n, D);
+    checksum += out[n - 1];
+  }
+  {
+    TmpVec out(n);
+    report(time_per_run([&] { sum_tmp(out, t, seq); }, min_seconds), n, D);
+    checksum += out.elems[n - 1];
+  }
+  {
+    std::vector<double> out(n);
+    auto f = [&] { sum_hand(out.data(), p.data(), n, seq); };
+    report(time_per_run(f, min_seconds), n, D);
+    checksum += out[n - 1];
+  }
+  std::cout << std::endl;
+}
+
+template <size_t... D>
+void run_depths(
+    size_t n, size_t max_bytes, double min_seconds, std::index_sequence<D...>
+)
+{
+  // inputs, output and the two live temporaries of the baseline
+  auto fits = [&](size_t d) {
+    return (d + 3) * n * sizeof(double) <= max_bytes;
+  };
+  ((fits(D + 2) ? run_case<D + 2>(n, min_seconds)
+                : void(std::cout << std::setw(11) << n << std::setw(6) << D + 2
+                                 << "   skipped, over the memory budget\n")),
+   ...);
+}
+
+// usage: crtp_et_bench [max length] [memory budget in MiB] [seconds per sample]
+int main(int argc, char** argv)
+{
+  size_t const max_n =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000;
+  size_t const max_bytes =
+      (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 3072) << 20;
+  double const min_seconds = argc > 3 ? std::atof(argv[3]) : 0.02;
+
+  std::cout << "isa " << et::isa_name(et::active_isa()) << ", " << et::threads()
+            << " thread(s)\n"
+            << std::setw(11) << "length" << std::setw(6) << "depth"
+            << std::setw(17) << "et" << std::setw(17) << "tmp" << std::setw(17)
+            << "hand" << '\n'
+            << std::setw(17) << ""
+            << "   ns/el    GB/s   ns/el    GB/s   ns/el    GB/s\n"
+            << std::fixed << std::setprecision(2);
+
+  std::vector<size_t> lengths = {3};
+  for (size_t n = 10; n <= max_n; n *= 10)
+    lengths.push_back(n);
+
+  for (size_t n : lengths)
+    run_depths(n, max_bytes, min_seconds, std::make_index_sequence<7>{});
+
+  std::cout << "checksum " << checksum << '\n';
+  return 0;
+}
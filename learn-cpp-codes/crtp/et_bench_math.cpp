@@ -0,0 +1,182 @@
+/**
+ * @file:	et_bench_math.cpp
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 22:30:00 Saturday
+ * @brief:	throughput and accuracy of et_math.h against scalar libm
+ **/
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "bench/bench.h"
+#include "et_math.h"
+
+// median of `reps` runs, in seconds
+template <typename F>
+double median_of(int reps, F&& f)
+{
+  bench::Options opt;
+  opt.warmup = 0.0;
+  opt.min_sample = 0.0; // one run per sample
+  opt.samples = static_cast<size_t>(reps);
+  return bench::measure(f, opt).median;
+}
+
+// distance from `got` to the exact value `ref`, in units in the last place
+// of the double nearest to `ref`
+double ulp_error(double got, long double ref)
+{
+  if (std::isnan(got) || std::isnan(ref))
+    return std::isnan(got) && std::isnan(ref) ? 0.0 : HUGE_VAL;
+  if (got == ref)
+    return 0.0;
+  double r = std::fabs(static_cast<double>(ref));
+  if (std::isinf(r))
+    r = std::numeric_limits<double>::max();
+  double ulp = std::nextafter(r, HUGE_VAL) - r;
+  return static_cast<double>(std::fabs(got - ref) / ulp);
+}
+
+struct Function
+{
+  char const* name;
+  void (*vec)(double const*, double*, size_t);
+  double (*libm)(double);
+  long double (*reference)(long double);
+};
+
+struct Domain
+{
+  char const* name;
+  std::vector<double> x;
+};
+
+std::mt19937_64 rng{42};
+
+std::vector<double> uniform(double lo, double hi, size_t n)
+{
+  std::uniform_real_distribution<double> d(lo, hi);
+  std::vector<double> x(n);
+  for (auto& v : x)
+    v = d(rng);
+  return x;
+}
+
+// the doubles next to multiples of pi/2 up to `hi`, where the reduction of
+// sin and cos cancels: for every binade of the multiple, equally likely, the
+// nearest double and its neighbours up to 2 ulp away
+std::vector<double> near_half_pi(double hi, size_t n)
+{
+  long double const half_pi = 1.57079632679489661923132169163975144L;
+  std::uniform_real_distribution<double> binade(0.0, std::log2(hi / half_pi));
+  std::uniform_int_distribution<int> step(-2, 2);
+  std::vector<double> x(n);
+  for (auto& v : x)
+  {
+    long double k = std::floor(std::exp2(static_cast<long double>(binade(rng))));
+    v = static_cast<double>(k * half_pi);
+    for (int s = step(rng); s != 0; s -= s > 0 ? 1 : -1)
+      v = std::nextafter(v, s > 0 ? HUGE_VAL : -HUGE_VAL);
+  }
+  return x;
+}
+
+// every binade equally likely, subnormals included
+std::vector<double> positive_bits(size_t n)
+{
+  std::uniform_int_distribution<uint64_t> d(1, 0x7fefffffffffffffull);
+  std::vector<double> x(n);
+  for (auto& v : x)
+    v = std::bit_cast<double>(d(rng));
+  return x;
+}
+
+void run(Function const& f, std::vector<Domain> const& domains, int reps)
+{
+  for (auto const& d : domains)
+  {
+    size_t const n = d.x.size();
+    std::vector<double> y_et(n), y_libm(n);
+
+    double t_libm = median_of(reps, [&] {
+      for (size_t i = 0; i < n; ++i)
+        y_libm[i] = f.libm(d.x[i]);
+    });
+    double t_et = median_of(reps, [&] { f.vec(d.x.data(), y_et.data(), n); });
+
+    double err_et = 0.0, err_libm = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      long double ref = f.reference(d.x[i]);
+      err_et = std::max(err_et, ulp_error(y_et[i], ref));
+      err_libm = std::max(err_libm, ulp_error(y_libm[i], ref));
+    }
+
+    double const el = static_cast<double>(n);
+    std::cout << std::left << std::setw(6) << f.name << std::setw(22) << d.name
+              << std::right << std::fixed << std::setprecision(2)
+              << std::setw(9) << t_libm * 1e9 / el << std::setw(9)
+              << t_et * 1e9 / el << std::setw(8) << t_libm / t_et << "x"
+              << std::setw(9) << err_libm << std::setw(9) << err_et << '\n';
+  }
+}
+
+// usage: crtp_et_math [log2 n] [sse2|avx2|avx512]
+int main(int argc, char** argv)
+{
+  size_t const n = size_t{1} << (argc > 1 ? std::atoi(argv[1]) : 20);
+  for (et::Isa isa : {et::Isa::sse2, et::Isa::avx2, et::Isa::avx512})
+    if (argc > 2 && std::string_view(argv[2]) == et::isa_name(isa))
+      et::set_isa(isa);
+  int const reps = 5;
+  double const pi = 3.141592653589793;
+  double const trig_max = et::math::trig_max;
+
+  std::cout << "n = " << n << ", isa " << et::isa_name(et::active_isa())
+            << ", times in ns/element, errors in ulp (max)\n"
+            << std::left << std::setw(6) << "fn" << std::setw(22) << "domain"
+            << std::right << std::setw(9) << "libm" << std::setw(9) << "et"
+            << std::setw(9) << "speedup" << std::setw(9) << "libm err"
+            << std::setw(9) << "et err" << '\n';
+
+  run({"exp", et::math::exp, [](double x) { return std::exp(x); },
+       [](long double x) { return std::exp(x); }},
+      {{"[-1, 1]", uniform(-1, 1, n)},
+       {"[-745, 709.7]", uniform(-745, 709.7, n)}},
+      reps);
+  run({"log", et::math::log, [](double x) { return std::log(x); },
+       [](long double x) { return std::log(x); }},
+      {{"[0.5, 2]", uniform(0.5, 2, n)},
+       {"all positive", positive_bits(n)}},
+      reps);
+  run({"sin", et::math::sin, [](double x) { return std::sin(x); },
+       [](long double x) { return std::sin(x); }},
+      {{"[-pi, pi]", uniform(-pi, pi, n)},
+       {"[-1e6, 1e6]", uniform(-1e6, 1e6, n)},
+       {"[-trig_max, trig_max]", uniform(-trig_max, trig_max, n)},
+       {"near k pi/2", near_half_pi(trig_max, n)}},
+      reps);
+  run({"cos", et::math::cos, [](double x) { return std::cos(x); },
+       [](long double x) { return std::cos(x); }},
+      {{"[-pi, pi]", uniform(-pi, pi, n)},
+       {"[-1e6, 1e6]", uniform(-1e6, 1e6, n)},
+       {"[-trig_max, trig_max]", uniform(-trig_max, trig_max, n)},
+       {"near k pi/2", near_half_pi(trig_max, n)}},
+      reps);
+  run({"tanh", et::math::tanh, [](double x) { return std::tanh(x); },
+       [](long double x) { return std::tanh(x); }},
+      {{"[-1, 1]", uniform(-1, 1, n)}, {"[-20, 20]", uniform(-20, 20, n)}},
+      reps);
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file:	et_bench_precision.cpp
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 19:30:00 Saturday
+ * @brief:	throughput of double, float and bfloat16 storage in expressions
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "bench/bench.h"
+#include "et_ops.h"
+#include "et_reduce.h"
+#include "et_vec.h"
+
+using namespace et;
+
+// median of `reps` runs, in seconds
+template <typename F>
+double median_of(int reps, F&& f)
+{
+  bench::Options opt;
+  opt.warmup = 0.0;
+  opt.min_sample = 0.0; // one run per sample
+  opt.samples = static_cast<size_t>(reps);
+  return bench::measure(f, opt).median;
+}
+
+struct Result
+{
+  double fma_s;   // y = a * b + c
+  double dot_s;   // sum(a * b)
+  double fma_err; // max |y - y_double|
+  double dot;
+};
+
+template <typename T>
+Result run(Vec const& a0, Vec const& b0, Vec const& c0, Vec const& ref, int reps)
+{
+  BasicVec<T> a(a0), b(b0), c(c0), y(a0.size());
+
+  Result r{};
+  r.fma_s = median_of(reps, [&] { y = a * b + c; });
+  r.dot_s = median_of(reps, [&] { r.dot = dot(a, b); });
+  r.fma_err = max(abs(y - ref));
+  return r;
+}
+
+void report(
+    char const* name, size_t bytes, size_t n, Result const& r, Result const& base
+)
+{
+  double const gb = 1e-9 * static_cast<double>(n * bytes);
+  std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(9) << r.fma_s * 1e3
+            << " ms" << std::setw(8) << 4 * gb / r.fma_s << " GB/s"
+            << std::setw(6) << base.fma_s / r.fma_s << "x" << std::setw(9)
+            << r.dot_s * 1e3 << " ms" << std::setw(8) << 2 * gb / r.dot_s
+            << " GB/s" << std::setw(6) << base.dot_s / r.dot_s << "x"
+            << std::scientific << std::setprecision(2) << std::setw(11)
+            << r.fma_err << std::setw(11)
+            << std::abs(r.dot - base.dot) / std::abs(base.dot) << '\n';
+}
+
+// usage: crtp_et_precision [log2 n] [threads]
+int main(int argc, char** argv)
+{
+  size_t const n = size_t{1} << (argc > 1 ? std::atoi(argv[1]) : 24);
+  set_threads(argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 1);
+  int const reps = 5;
+
+  Vec a(n), b(n), c(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    a[i] = std::sin(0.001 * static_cast<double>(i));
+    b[i] = std::cos(0.003 * static_cast<double>(i));
+    c[i] = 1.0 / (1.0 + static_cast<double>(i % 1000));
+  }
+  Vec ref = a * b + c;
+
+  std::cout << "n = " << n << ", " << threads() << " thread(s), isa "
+            << isa_name(active_isa()) << "\n"
+            << "storage     y = a * b + c (4 streams)     "
+               "sum(a * b) (2 streams)       max err   dot err\n";
+
+  Result const d = run<double>(a, b, c, ref, reps);
+  Result const f = run<float>(a, b, c, ref, reps);
+  Result const h = run<bfloat16>(a, b, c, ref, reps);
+
+  report("double", sizeof(double), n, d, d);
+  report("float", sizeof(float), n, f, d);
+  report("bfloat16", sizeof(bfloat16), n, h, d);
+
+  return 0;
+}
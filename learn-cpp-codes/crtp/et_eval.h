@@ -0,0 +1,233 @@
+/**
+ * @file:	et_eval.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 20:45:00 Saturday
+ * @brief:	`eval()`: materialize a subexpression once into scratch memory
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "et_parallel.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+// ================================================================================================
+// Scratch arena
+// ================================================================================================
+
+// A per-thread stack allocator for the results of `eval`. Allocations are
+// handed out from aligned blocks and given back in stack order: releasing the
+// most recent one moves the top back to where it started, so an evaluation
+// repeated in a loop under a longer-lived one (a hoisted `eval`) reuses the
+// same bytes every iteration. A release out of order is only recorded, and
+// its bytes come back once everything above it is released too.
+//
+// When the last allocation is released and blocks were added meanwhile, all
+// blocks are merged into a single one large enough for the peak, so a loop
+// doing the same evaluations every iteration reaches a steady state without
+// any call to the system allocator.
+class ScratchArena
+{
+  struct Block
+  {
+    AlignedArray<std::byte> data;
+    size_t size;
+  };
+
+  // where an allocation starts, to go back there on release
+  struct Mark
+  {
+    void const* p;
+    size_t block;
+    size_t used;
+    bool released;
+  };
+
+  static constexpr size_t min_block = size_t{1} << 16;
+
+  std::vector<Block> blocks;
+  std::vector<Mark> stack;
+  size_t current = 0; // block allocated from
+  size_t used = 0;    // bytes taken from it
+  size_t system_allocations = 0;
+
+  void add_block(size_t size)
+  {
+    blocks.push_back(Block{allocate_aligned<std::byte>(size), size});
+    ++system_allocations;
+  }
+
+  void rewind()
+  {
+    current = 0;
+    used = 0;
+    if (blocks.size() > 1)
+    {
+      size_t total = capacity();
+      blocks.clear();
+      add_block(total);
+    }
+  }
+
+public:
+  ScratchArena() = default;
+  ScratchArena(ScratchArena const&) = delete;
+  ScratchArena& operator=(ScratchArena const&) = delete;
+
+  // uninitialized, aligned like a `Vec`
+  template <typename T>
+  T* allocate(size_t n)
+  {
+    size_t const bytes =
+        (n * sizeof(T) + vec_alignment - 1) / vec_alignment * vec_alignment;
+    Mark mark{nullptr, current, used, false};
+
+    if (blocks.empty() || used + bytes > blocks[current].size)
+    {
+      // the blocks past the current one hold nothing live
+      if (!blocks.empty() && current + 1 < blocks.size() &&
+          bytes <= blocks[current + 1].size)
+        ++current;
+      else
+      {
+        size_t grown = blocks.empty() ? 0 : 2 * blocks.back().size;
+        if (!blocks.empty())
+          blocks.resize(current + 1);
+        add_block(std::max({bytes, min_block, grown}));
+        current = blocks.size() - 1;
+      }
+      used = 0;
+    }
+
+    std::byte* p = blocks[current].data.get() + used;
+    used += bytes;
+    mark.p = p;
+    stack.push_back(mark);
+    return reinterpret_cast<T*>(p);
+  }
+
+  // `p` from `allocate` of this arena, usually the most recent one; anything
+  // else, such as memory of the arena of another thread, throws and leaves
+  // the arena as it was
+  void release(void const* p)
+  {
+    auto it = std::find_if(stack.rbegin(), stack.rend(), [&](Mark const& m) {
+      return m.p == p && !m.released;
+    });
+    if (it == stack.rend())
+      throw std::logic_error("scratch memory not from this arena");
+    it->released = true;
+
+    while (!stack.empty() && stack.back().released)
+    {
+      current = stack.back().block;
+      used = stack.back().used;
+      stack.pop_back();
+    }
+    if (stack.empty())
+      rewind();
+  }
+
+  // allocations not yet given back
+  size_t live() const { return stack.size(); }
+
+  size_t capacity() const
+  {
+    size_t total = 0;
+    for (auto const& b : blocks)
+      total += b.size;
+    return total;
+  }
+
+  // number of blocks obtained from the system so far
+  size_t allocations() const { return system_allocations; }
+};
+
+inline ScratchArena& scratch_arena()
+{
+  thread_local ScratchArena arena;
+  return arena;
+}
+
+// ================================================================================================
+// eval
+// ================================================================================================
+
+// The value of an expression, computed once at construction into the scratch
+// arena of the calling thread, and given back to it on destruction. It is a
+// leaf, so the nodes built on it refer to it like to a `Vec` and it has to
+// outlive them: name it when it is used by several expressions.
+//
+//   auto ab = eval(a + b);     // one pass over a and b
+//   y = ab * ab + c / ab;      // three reads of ab, no recomputation
+//
+// Owned by the thread that created it, and destroyed there: the arena of
+// another thread does not know its memory, and the destructor terminates.
+// Not copyable, only movable.
+class VecEval : public VecExpression<VecEval>
+{
+  double* p = nullptr;
+  size_t n = 0;
+
+public:
+  static constexpr bool is_leaf = true;
+
+  template <typename E>
+  explicit VecEval(VecExpression<E> const& expr) : n{expr.size()}
+  {
+    if (n == 0)
+      return;
+    p = scratch_arena().allocate<double>(n);
+    assign(p, static_cast<E const&>(expr), n);
+  }
+
+  VecEval(VecEval&& other) noexcept
+      : p{std::exchange(other.p, nullptr)}, n{std::exchange(other.n, 0)}
+  {
+  }
+
+  VecEval(VecEval const&) = delete;
+  VecEval& operator=(VecEval const&) = delete;
+  VecEval& operator=(VecEval&&) = delete;
+
+  ~VecEval()
+  {
+    if (p)
+      scratch_arena().release(p);
+  }
+
+  double operator[](size_t i) const { return p[i]; }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    return Packet<W>::load(p + i);
+  }
+
+  size_t size() const { return n; }
+
+  template <typename T>
+  bool reads_shifted(T const* out, size_t len) const
+  {
+    return overlaps_shifted(p, n, out, len);
+  }
+
+  double const* data() const { return p; }
+};
+
+template <typename E>
+VecEval eval(VecExpression<E> const& expr)
+{
+  return VecEval(expr);
+}
+
+} // namespace et
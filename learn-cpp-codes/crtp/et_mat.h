@@ -0,0 +1,582 @@
+/**
+ * @file:	et_mat.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 18:10:00 Saturday
+ * @brief:	matrix expression templates & a cache-blocked product node
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "et_ops.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+// `MatExpression` is the 2-D counterpart of `VecExpression`: a CRTP base for
+// anything matrix-valued. Matrices are row-major, so `packet<W>(r, c)` is W
+// consecutive columns `[c, c + W)` of row `r`.
+template <typename E>
+class MatExpression
+{
+public:
+  static constexpr bool is_leaf = false;
+
+  double operator()(size_t r, size_t c) const
+  {
+    return static_cast<E const&>(*this)(r, c);
+  }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t r, size_t c) const
+  {
+    return static_cast<E const&>(*this).template packet<W>(r, c);
+  }
+
+  size_t rows() const { return static_cast<E const&>(*this).rows(); }
+  size_t cols() const { return static_cast<E const&>(*this).cols(); }
+};
+
+template <typename E1, typename E2>
+void check_shape(MatExpression<E1> const& u, MatExpression<E2> const& v)
+{
+  if (u.rows() != v.rows() || u.cols() != v.cols())
+    throw std::length_error(
+        "MatExpression shape mismatch: " + std::to_string(u.rows()) + "x" +
+        std::to_string(u.cols()) + " vs " + std::to_string(v.rows()) + "x" +
+        std::to_string(v.cols())
+    );
+}
+
+// Evaluates `e` into the row-major `out`, row by row, W columns at a time.
+template <typename E>
+struct MatAssignKernel
+{
+  double* out;
+  E const& e;
+  size_t rows;
+  size_t cols;
+
+  template <size_t W>
+  ET_INLINE void run() const
+  {
+    for (size_t r = 0; r < rows; ++r)
+    {
+      double* row = out + r * cols;
+      size_t c = 0;
+      for (; c + W <= cols; c += W)
+        e.template packet<W>(r, c).store(row + c);
+      for (; c != cols; ++c)
+        row[c] = e(r, c);
+    }
+  }
+};
+
+template <typename E1, typename E2>
+class MatProduct;
+
+// A dense row-major matrix in one 64-byte aligned block.
+class Mat : public MatExpression<Mat>
+{
+  size_t _rows = 0;
+  size_t _cols = 0;
+  AlignedBuffer elems;
+
+public:
+  static constexpr bool is_leaf = true;
+
+  Mat() = default;
+
+  Mat(size_t rows, size_t cols, double value = 0.0)
+      : _rows{rows}, _cols{cols}, elems{allocate_aligned(rows * cols)}
+  {
+    std::fill_n(elems.get(), rows * cols, value);
+  }
+
+  // one initializer list per row
+  Mat(std::initializer_list<std::initializer_list<double>> init)
+      : _rows{init.size()},
+        _cols{init.size() ? init.begin()->size() : 0},
+        elems{allocate_aligned(_rows * _cols)}
+  {
+    double* out = elems.get();
+    for (auto const& row : init)
+    {
+      if (row.size() != _cols)
+        throw std::length_error("Mat: rows of different lengths");
+      out = std::copy(row.begin(), row.end(), out);
+    }
+  }
+
+  Mat(Mat const& other)
+      : _rows{other._rows},
+        _cols{other._cols},
+        elems{allocate_aligned(other._rows * other._cols)}
+  {
+    std::copy_n(other.elems.get(), _rows * _cols, elems.get());
+  }
+
+  Mat(Mat&& other) noexcept
+      : _rows{std::exchange(other._rows, 0)},
+        _cols{std::exchange(other._cols, 0)},
+        elems{std::move(other.elems)}
+  {
+  }
+
+  Mat& operator=(Mat const& other)
+  {
+    if (this != &other)
+      *this = Mat(other);
+    return *this;
+  }
+
+  Mat& operator=(Mat&& other) noexcept
+  {
+    _rows = std::exchange(other._rows, 0);
+    _cols = std::exchange(other._cols, 0);
+    elems = std::move(other.elems);
+    return *this;
+  }
+
+  // forces the evaluation of any elementwise expression, in a single pass
+  template <typename E>
+  Mat(MatExpression<E> const& expr)
+      : _rows{expr.rows()},
+        _cols{expr.cols()},
+        elems{allocate_aligned(_rows * _cols)}
+  {
+    dispatch(MatAssignKernel<E>{
+        elems.get(), static_cast<E const&>(expr), _rows, _cols
+    });
+  }
+
+  // a product already owns its result, it is moved instead of copied
+  template <typename E1, typename E2>
+  Mat(MatProduct<E1, E2>&& product) : Mat(product.take())
+  {
+  }
+
+  double operator()(size_t r, size_t c) const { return elems[r * _cols + c]; }
+
+  double& operator()(size_t r, size_t c) { return elems[r * _cols + c]; }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t r, size_t c) const
+  {
+    return Packet<W>::load(elems.get() + r * _cols + c);
+  }
+
+  size_t rows() const { return _rows; }
+  size_t cols() const { return _cols; }
+
+  double* data() { return elems.get(); }
+  double const* data() const { return elems.get(); }
+};
+
+// ================================================================================================
+// Elementwise nodes, sharing the operations of et_vec.h / et_ops.h
+// ================================================================================================
+
+// cref if leaf, copy otherwise
+template <typename Op, typename E1, typename E2>
+class MatBinary : public MatExpression<MatBinary<Op, E1, E2>>
+{
+  typename std::conditional_t<E1::is_leaf, const E1&, const E1> _u;
+  typename std::conditional_t<E2::is_leaf, const E2&, const E2> _v;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  MatBinary(E1 const& u, E2 const& v) : _u(u), _v(v) { check_shape(u, v); }
+
+  double operator()(size_t r, size_t c) const
+  {
+    return Op::apply(_u(r, c), _v(r, c));
+  }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t r, size_t c) const
+  {
+    return Op::apply(
+        _u.template packet<W>(r, c), _v.template packet<W>(r, c)
+    );
+  }
+
+  size_t rows() const { return _v.rows(); }
+  size_t cols() const { return _v.cols(); }
+};
+
+template <typename Op, typename E>
+class MatUnary : public MatExpression<MatUnary<Op, E>>
+{
+  typename std::conditional_t<E::is_leaf, const E&, const E> _u;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  explicit MatUnary(E const& u) : _u(u) {}
+
+  double operator()(size_t r, size_t c) const { return Op::apply(_u(r, c)); }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t r, size_t c) const
+  {
+    return Op::apply(_u.template packet<W>(r, c));
+  }
+
+  size_t rows() const { return _u.rows(); }
+  size_t cols() const { return _u.cols(); }
+};
+
+// scalar broadcast to the shape of the other operand
+class MatConst : public MatExpression<MatConst>
+{
+  double _c;
+  size_t _rows;
+  size_t _cols;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  MatConst(double c, size_t rows, size_t cols)
+      : _c{c}, _rows{rows}, _cols{cols}
+  {
+  }
+
+  double operator()(size_t, size_t) const { return _c; }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t, size_t) const
+  {
+    return Packet<W>::broadcast(_c);
+  }
+
+  size_t rows() const { return _rows; }
+  size_t cols() const { return _cols; }
+};
+
+template <typename E1, typename E2>
+MatBinary<Plus, E1, E2>
+operator+(MatExpression<E1> const& u, MatExpression<E2> const& v)
+{
+  return MatBinary<Plus, E1, E2>(
+      *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)
+  );
+}
+
+template <typename E1, typename E2>
+MatBinary<Minus, E1, E2>
+operator-(MatExpression<E1> const& u, MatExpression<E2> const& v)
+{
+  return MatBinary<Minus, E1, E2>(
+      *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)
+  );
+}
+
+// elementwise product, `*` being the matrix product
+template <typename E1, typename E2>
+MatBinary<Multiplies, E1, E2>
+hadamard(MatExpression<E1> const& u, MatExpression<E2> const& v)
+{
+  return MatBinary<Multiplies, E1, E2>(
+      *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)
+  );
+}
+
+template <typename E>
+MatUnary<Negate, E> operator-(MatExpression<E> const& u)
+{
+  return MatUnary<Negate, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+MatBinary<Multiplies, MatConst, E>
+operator*(double c, MatExpression<E> const& u)
+{
+  return MatBinary<Multiplies, MatConst, E>(
+      MatConst(c, u.rows(), u.cols()), *static_cast<const E*>(&u)
+  );
+}
+
+template <typename E>
+MatBinary<Multiplies, E, MatConst>
+operator*(MatExpression<E> const& u, double c)
+{
+  return MatBinary<Multiplies, E, MatConst>(
+      *static_cast<const E*>(&u), MatConst(c, u.rows(), u.cols())
+  );
+}
+
+template <typename E>
+MatBinary<Divides, E, MatConst>
+operator/(MatExpression<E> const& u, double c)
+{
+  return MatBinary<Divides, E, MatConst>(
+      *static_cast<const E*>(&u), MatConst(c, u.rows(), u.cols())
+  );
+}
+
+template <typename E>
+MatUnary<Abs, E> abs(MatExpression<E> const& u)
+{
+  return MatUnary<Abs, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+MatUnary<Sqrt, E> sqrt(MatExpression<E> const& u)
+{
+  return MatUnary<Sqrt, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+MatUnary<Exp, E> exp(MatExpression<E> const& u)
+{
+  return MatUnary<Exp, E>(*static_cast<const E*>(&u));
+}
+
+// ================================================================================================
+// Blocked product
+// ================================================================================================
+
+// Blocking follows the usual GotoBLAS layout:
+//
+// - a KC x NC panel of B is packed once and stays in L3
+// - an MC x KC block of A is packed and stays in L2
+// - the micro-kernel keeps an MR x NR tile of C in registers and streams one
+//   column of packed A and one row of packed B per step of k, both from L1
+//
+// Packing reads the operands through `operator()`, so an elementwise operand
+// such as `(A + B) * C` is fused into the packing and never materialized.
+inline constexpr size_t gemm_kc = 256;
+inline constexpr size_t gemm_mc = 128;
+inline constexpr size_t gemm_nc = 2048;
+inline constexpr size_t gemm_mr = 4;
+
+// NR = 2 vectors, i.e. 8 accumulators of W lanes in the micro-kernel
+template <size_t W>
+inline constexpr size_t gemm_nr = 2 * W;
+
+#if defined(__GNUC__)
+
+// GCC rejects `vector_size` on an alias template, a member typedef works
+template <size_t W>
+struct NativeVector
+{
+  typedef double type __attribute__((vector_size(W * sizeof(double))));
+};
+
+#define ET_GEMM_UNROLL _Pragma("GCC unroll 16")
+
+#else
+
+// without GNU vector extensions (not GCC or Clang: MSVC, say) the
+// accumulators are packets: correct, but left to the optimizer to keep in
+// registers
+template <size_t W>
+struct NativeVector
+{
+  using type = Packet<W>;
+};
+
+// the two vector operations of the micro-kernel
+template <size_t W>
+ET_INLINE Packet<W> operator*(double a, Packet<W> const& b)
+{
+  return Packet<W>::broadcast(a) * b;
+}
+
+template <size_t W>
+ET_INLINE Packet<W>& operator+=(Packet<W>& a, Packet<W> const& b)
+{
+  return a = a + b;
+}
+
+#define ET_GEMM_UNROLL
+
+#endif
+
+// `Ap[k * MR + i] = A(ic + i, pc + k)`, rows past the end are zero-padded
+template <typename E>
+void pack_a(double* Ap, E const& a, size_t ic, size_t mc, size_t pc, size_t kc)
+{
+  constexpr size_t MR = gemm_mr;
+  for (size_t ir = 0; ir < mc; ir += MR, Ap += MR * kc)
+  {
+    size_t m = std::min(MR, mc - ir);
+    for (size_t k = 0; k < kc; ++k)
+      for (size_t i = 0; i < MR; ++i)
+        Ap[k * MR + i] = i < m ? a(ic + ir + i, pc + k) : 0.0;
+  }
+}
+
+// `Bp[k * NR + j] = B(pc + k, jc + j)`, columns past the end are zero-padded
+template <size_t NR, typename E>
+void pack_b(double* Bp, E const& b, size_t pc, size_t kc, size_t jc, size_t nc)
+{
+  for (size_t jr = 0; jr < nc; jr += NR, Bp += NR * kc)
+  {
+    size_t n = std::min(NR, nc - jr);
+    for (size_t k = 0; k < kc; ++k)
+      for (size_t j = 0; j < NR; ++j)
+        Bp[k * NR + j] = j < n ? b(pc + k, jc + jr + j) : 0.0;
+  }
+}
+
+// C[0, m) x [0, n) += Ap * Bp over `kc` steps, with C at stride `ldc`
+//
+// Unlike the elementwise kernels this one uses the compiler vector type
+// directly: the MR x NB accumulators are carried across the k loop, and GCC
+// only keeps them in registers as vectors, not as `Packet` lane arrays. That
+// type is the GNU `vector_size` extension, which GCC and Clang both provide
+// (Clang defines `__GNUC__` too); only a compiler without it, MSVC say, gets
+// the `Packet` fallback above. The function is always inlined into the ISA
+// specific kernel, so no vector value ever crosses a call boundary (which is
+// what makes them ABI sensitive).
+// `acc += a * b` becomes an FMA under GCC's default `-ffp-contract=fast`.
+template <size_t W>
+ET_INLINE void gemm_micro(
+    size_t kc, double const* Ap, double const* Bp, double* C, size_t ldc,
+    size_t m, size_t n
+)
+{
+  constexpr size_t MR = gemm_mr;
+  constexpr size_t NR = gemm_nr<W>;
+  constexpr size_t NB = NR / W;
+  using V = typename NativeVector<W>::type;
+
+  V acc[MR][NB] = {};
+  for (size_t k = 0; k < kc; ++k, Ap += MR, Bp += NR)
+  {
+    V b[NB];
+    ET_GEMM_UNROLL
+    for (size_t j = 0; j < NB; ++j)
+      std::memcpy(&b[j], Bp + j * W, sizeof(V));
+    ET_GEMM_UNROLL
+    for (size_t i = 0; i < MR; ++i)
+      ET_GEMM_UNROLL
+      for (size_t j = 0; j < NB; ++j)
+        acc[i][j] += Ap[i] * b[j];
+  }
+
+  double tile[MR * NR];
+  std::memcpy(tile, acc, sizeof(tile));
+  for (size_t i = 0; i < m; ++i)
+    for (size_t j = 0; j < n; ++j)
+      C[i * ldc + j] += tile[i * NR + j];
+}
+
+template <typename E1, typename E2>
+struct GemmKernel
+{
+  double* C; // zero-initialized, M x N
+  E1 const& a;
+  E2 const& b;
+  size_t M, N, K;
+
+  template <size_t W>
+  ET_INLINE void run() const
+  {
+    constexpr size_t MR = gemm_mr;
+    constexpr size_t NR = gemm_nr<W>;
+    constexpr size_t KC = gemm_kc;
+    constexpr size_t MC = gemm_mc;
+    constexpr size_t NC = gemm_nc;
+
+    AlignedBuffer Ap = allocate_aligned(MC * KC);
+    AlignedBuffer Bp = allocate_aligned(KC * ((NC + NR - 1) / NR * NR));
+
+    for (size_t jc = 0; jc < N; jc += NC)
+    {
+      size_t nc = std::min(NC, N - jc);
+      for (size_t pc = 0; pc < K; pc += KC)
+      {
+        size_t kc = std::min(KC, K - pc);
+        pack_b<NR>(Bp.get(), b, pc, kc, jc, nc);
+
+        for (size_t ic = 0; ic < M; ic += MC)
+        {
+          size_t mc = std::min(MC, M - ic);
+          pack_a(Ap.get(), a, ic, mc, pc, kc);
+
+          for (size_t jr = 0; jr < nc; jr += NR)
+            for (size_t ir = 0; ir < mc; ir += MR)
+              gemm_micro<W>(
+                  kc, Ap.get() + ir * kc, Bp.get() + jr * kc,
+                  C + (ic + ir) * N + jc + jr, N, std::min(MR, mc - ir),
+                  std::min(NR, nc - jr)
+              );
+        }
+      }
+    }
+  }
+};
+
+// The product is not evaluated element by element: each element would be a
+// K-long dot product recomputed on every access. Unlike every other node it is
+// not lazy either: the constructor runs the blocked kernel right away, into a
+// `shared_ptr<Mat>` the node holds, shared so that copying the node into an
+// enclosing expression stays cheap. Building `a * b` costs the product even
+// if the node is never read. `Mat c = a * b` takes the
+// result over without copying, and `a * b + c` is one more fused pass.
+template <typename E1, typename E2>
+class MatProduct : public MatExpression<MatProduct<E1, E2>>
+{
+  std::shared_ptr<Mat> _result;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  MatProduct(E1 const& a, E2 const& b)
+  {
+    if (a.cols() != b.rows())
+      throw std::length_error(
+          "MatProduct inner dimensions mismatch: " + std::to_string(a.cols()) +
+          " vs " + std::to_string(b.rows())
+      );
+    _result = std::make_shared<Mat>(a.rows(), b.cols(), 0.0);
+    dispatch(GemmKernel<E1, E2>{
+        _result->data(), a, b, a.rows(), b.cols(), a.cols()
+    });
+  }
+
+  double operator()(size_t r, size_t c) const { return (*_result)(r, c); }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t r, size_t c) const
+  {
+    return _result->template packet<W>(r, c);
+  }
+
+  size_t rows() const { return _result->rows(); }
+  size_t cols() const { return _result->cols(); }
+
+  // the result, moved out if this node is its only owner
+  Mat take()
+  {
+    if (_result.use_count() == 1)
+      return std::move(*_result);
+    return *_result;
+  }
+};
+
+template <typename E1, typename E2>
+MatProduct<E1, E2>
+operator*(MatExpression<E1> const& a, MatExpression<E2> const& b)
+{
+  return MatProduct<E1, E2>(
+      *static_cast<const E1*>(&a), *static_cast<const E2*>(&b)
+  );
+}
+
+} // namespace et
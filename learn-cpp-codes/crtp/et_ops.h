@@ -0,0 +1,315 @@
+/**
+ * @file:	et_ops.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 16:10:00 Saturday
+ * @brief:	lazy operator algebra over `VecExpression`s
+ **/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "et_math.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+// ================================================================================================
+// Binary operations, see `Plus` in et_vec.h
+// ================================================================================================
+
+struct Minus
+{
+  static double apply(double a, double b) { return a - b; }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> apply(Packet<W> const& a, Packet<W> const& b)
+  {
+    return a - b;
+  }
+};
+
+struct Multiplies
+{
+  static double apply(double a, double b) { return a * b; }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> apply(Packet<W> const& a, Packet<W> const& b)
+  {
+    return a * b;
+  }
+};
+
+struct Divides
+{
+  static double apply(double a, double b) { return a / b; }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> apply(Packet<W> const& a, Packet<W> const& b)
+  {
+    return a / b;
+  }
+};
+
+template <typename E1, typename E2>
+using VecDiff = VecBinary<Minus, E1, E2>;
+
+template <typename E1, typename E2>
+using VecProd = VecBinary<Multiplies, E1, E2>;
+
+template <typename E1, typename E2>
+using VecQuot = VecBinary<Divides, E1, E2>;
+
+// ================================================================================================
+// Unary operations
+// ================================================================================================
+
+// A unary operation only needs the scalar `apply`: the default packet form
+// runs it on every lane. Operations with a cheaper packet form provide their
+// own overload.
+template <typename Derived>
+struct LaneWise
+{
+  template <size_t W>
+  ET_INLINE static Packet<W> apply(Packet<W> a)
+  {
+    for (size_t k = 0; k < W; ++k)
+      a.v[k] = Derived::apply(a.v[k]);
+    return a;
+  }
+};
+
+struct Negate : LaneWise<Negate>
+{
+  using LaneWise::apply;
+  static double apply(double a) { return -a; }
+};
+
+struct Abs : LaneWise<Abs>
+{
+  using LaneWise::apply;
+  static double apply(double a) { return std::fabs(a); }
+};
+
+// `sqrt` lanes become one SIMD instruction only when the compiler may ignore
+// `errno` (`-fno-math-errno`, set for the crtp_et target).
+struct Sqrt : LaneWise<Sqrt>
+{
+  using LaneWise::apply;
+  static double apply(double a) { return std::sqrt(a); }
+};
+
+// `Exp`, `Log`, `Sin`, `Cos` and `Tanh` run the vectorizable kernels of
+// et_math.h instead of libm.
+
+// Same storage rule as `VecBinary`: cref if leaf, copy otherwise.
+template <typename Op, typename E>
+class VecUnary : public VecExpression<VecUnary<Op, E>>
+{
+  typename std::conditional_t<E::is_leaf, const E&, const E> _u;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  explicit VecUnary(E const& u) : _u(u) {}
+
+  double operator[](size_t i) const { return Op::apply(_u[i]); }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    return Op::apply(_u.template packet<W>(i));
+  }
+
+  size_t size() const { return _u.size(); }
+
+  template <typename T>
+  bool reads_shifted(T const* out, size_t n) const
+  {
+    return _u.reads_shifted(out, n);
+  }
+
+  E const& arg() const { return _u; }
+};
+
+// ================================================================================================
+// Scalars
+// ================================================================================================
+
+// A scalar taking part in an expression is broadcast to the size of the other
+// operand. It holds no data, so it is not a leaf and is stored by value.
+class VecConst : public VecExpression<VecConst>
+{
+  double _c;
+  size_t _n;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  VecConst(double c, size_t n) : _c{c}, _n{n} {}
+
+  double operator[](size_t) const { return _c; }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t) const
+  {
+    return Packet<W>::broadcast(_c);
+  }
+
+  size_t size() const { return _n; }
+
+  template <typename T>
+  bool reads_shifted(T const*, size_t) const
+  {
+    return false;
+  }
+
+  double value() const { return _c; }
+};
+
+// ================================================================================================
+// Operators
+// ================================================================================================
+
+template <typename E1, typename E2>
+VecDiff<E1, E2> operator-(VecExpression<E1> const& u, VecExpression<E2> const& v)
+{
+  return VecDiff<E1, E2>(
+      *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)
+  );
+}
+
+template <typename E1, typename E2>
+VecProd<E1, E2> operator*(VecExpression<E1> const& u, VecExpression<E2> const& v)
+{
+  return VecProd<E1, E2>(
+      *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)
+  );
+}
+
+template <typename E1, typename E2>
+VecQuot<E1, E2> operator/(VecExpression<E1> const& u, VecExpression<E2> const& v)
+{
+  return VecQuot<E1, E2>(
+      *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)
+  );
+}
+
+template <typename E>
+VecUnary<Negate, E> operator-(VecExpression<E> const& u)
+{
+  return VecUnary<Negate, E>(*static_cast<const E*>(&u));
+}
+
+// scalar on either side, e.g. `a * x + 1.0`, `2.0 / d`
+#define ET_SCALAR_OPERATOR(op, Op)                                             \
+  template <typename E>                                                        \
+  VecBinary<Op, E, VecConst> operator op(VecExpression<E> const& u, double c)  \
+  {                                                                            \
+    return VecBinary<Op, E, VecConst>(                                         \
+        *static_cast<const E*>(&u), VecConst(c, u.size())                      \
+    );                                                                         \
+  }                                                                            \
+                                                                               \
+  template <typename E>                                                        \
+  VecBinary<Op, VecConst, E> operator op(double c, VecExpression<E> const& u)  \
+  {                                                                            \
+    return VecBinary<Op, VecConst, E>(                                         \
+        VecConst(c, u.size()), *static_cast<const E*>(&u)                      \
+    );                                                                         \
+  }
+
+ET_SCALAR_OPERATOR(+, Plus)
+ET_SCALAR_OPERATOR(-, Minus)
+ET_SCALAR_OPERATOR(*, Multiplies)
+ET_SCALAR_OPERATOR(/, Divides)
+
+#undef ET_SCALAR_OPERATOR
+
+// ================================================================================================
+// Compound assignment
+// ================================================================================================
+
+// `v op= e` is evaluated as `v = v op e` straight into the storage of `v`:
+// one read and one write stream over `v`, no new buffer. Only when `e` reads
+// `v` at a shifted index is `e` evaluated into a temporary first.
+template <typename Op, typename T, typename E>
+BasicVec<T>& compound_assign(BasicVec<T>& v, E const& e)
+{
+  check_size(v, e);
+  if (e.reads_shifted(v.data(), v.size()))
+    return compound_assign<Op>(v, Vec(e));
+  assign(v.data(), VecBinary<Op, BasicVec<T>, E>(v, e), v.size());
+  return v;
+}
+
+#define ET_COMPOUND_OPERATOR(op, Op)                                           \
+  template <typename T, typename E>                                            \
+  BasicVec<T>& operator op(BasicVec<T>& v, VecExpression<E> const& e)          \
+  {                                                                            \
+    return compound_assign<Op>(v, static_cast<E const&>(e));                   \
+  }                                                                            \
+                                                                               \
+  template <typename T>                                                        \
+  BasicVec<T>& operator op(BasicVec<T>& v, double c)                           \
+  {                                                                            \
+    return compound_assign<Op>(v, VecConst(c, v.size()));                      \
+  }
+
+ET_COMPOUND_OPERATOR(+=, Plus)
+ET_COMPOUND_OPERATOR(-=, Minus)
+ET_COMPOUND_OPERATOR(*=, Multiplies)
+ET_COMPOUND_OPERATOR(/=, Divides)
+
+#undef ET_COMPOUND_OPERATOR
+
+// ================================================================================================
+// Unary math, found by ADL for any `VecExpression`
+// ================================================================================================
+
+template <typename E>
+VecUnary<Abs, E> abs(VecExpression<E> const& u)
+{
+  return VecUnary<Abs, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+VecUnary<Sqrt, E> sqrt(VecExpression<E> const& u)
+{
+  return VecUnary<Sqrt, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+VecUnary<Exp, E> exp(VecExpression<E> const& u)
+{
+  return VecUnary<Exp, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+VecUnary<Log, E> log(VecExpression<E> const& u)
+{
+  return VecUnary<Log, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+VecUnary<Sin, E> sin(VecExpression<E> const& u)
+{
+  return VecUnary<Sin, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+VecUnary<Cos, E> cos(VecExpression<E> const& u)
+{
+  return VecUnary<Cos, E>(*static_cast<const E*>(&u));
+}
+
+template <typename E>
+VecUnary<Tanh, E> tanh(VecExpression<E> const& u)
+{
+  return VecUnary<Tanh, E>(*static_cast<const E*>(&u));
+}
+
+} // namespace et
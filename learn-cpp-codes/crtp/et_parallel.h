@@ -0,0 +1,243 @@
+/**
+ * @file:	et_parallel.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 17:05:00 Saturday
+ * @brief:	opt-in multithreaded, chunked evaluation of vector expressions
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "et_simd.h"
+
+namespace et
+{
+
+// A fixed set of workers running one job at a time. A job is a number of
+// chunks; workers and the calling thread take chunks from a shared counter
+// until none is left, so uneven chunks balance themselves.
+//
+// A job started from inside a job of the same pool (a parallel `assign`
+// reached from a chunk, say) runs on the calling thread: it would otherwise
+// wait for the workers, which wait for it.
+//
+// A chunk that throws ends the job: the chunks not yet taken are skipped,
+// and once every thread is out of the job, the first exception is rethrown
+// to the caller of `run`.
+class ThreadPool
+{
+  using Task = void (*)(void const* ctx, size_t chunk);
+
+  // the pool whose chunks the current thread is running, if any
+  static inline thread_local ThreadPool const* running = nullptr;
+
+  struct Running
+  {
+    ThreadPool const* saved;
+    explicit Running(ThreadPool const* pool) : saved{running}
+    {
+      running = pool;
+    }
+    ~Running() { running = saved; }
+  };
+
+  std::vector<std::thread> workers;
+
+  std::mutex run_mutex; // one job at a time
+  std::mutex m;
+  std::condition_variable cv_start;
+  std::condition_variable cv_done;
+  uint64_t generation = 0;
+  size_t pending = 0;
+  bool stop = false;
+
+  Task task = nullptr;
+  void const* ctx = nullptr;
+  size_t n_chunks = 0;
+  std::atomic<size_t> next{0};
+  std::exception_ptr error; // the first one of the job, under `m`
+
+  void drain()
+  {
+    size_t c;
+    while ((c = next.fetch_add(1, std::memory_order_relaxed)) < n_chunks)
+      try
+      {
+        task(ctx, c);
+      }
+      catch (...)
+      {
+        next.store(n_chunks, std::memory_order_relaxed);
+        std::lock_guard lock{m};
+        if (!error)
+          error = std::current_exception();
+      }
+  }
+
+  void work()
+  {
+    Running in_pool{this};
+    uint64_t seen = 0;
+    for (;;)
+    {
+      {
+        std::unique_lock lock{m};
+        cv_start.wait(lock, [&] { return stop || generation != seen; });
+        if (stop)
+          return;
+        seen = generation;
+      }
+      drain();
+      {
+        std::lock_guard lock{m};
+        if (--pending == 0)
+          cv_done.notify_one();
+      }
+    }
+  }
+
+public:
+  // `threads` counts the calling thread, hence `threads - 1` workers
+  explicit ThreadPool(size_t threads)
+  {
+    for (size_t t = 1; t < threads; ++t)
+      workers.emplace_back([this] { work(); });
+  }
+
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard lock{m};
+      stop = true;
+    }
+    cv_start.notify_all();
+    for (auto& w : workers)
+      w.join();
+  }
+
+  size_t size() const { return workers.size() + 1; }
+
+  // Calls `f(c)` for every `c` in `[0, chunks)` and returns once all are done;
+  // serially when called from inside a chunk of this pool. Rethrows the first
+  // exception thrown by `f`, after the other threads have left `f`.
+  template <typename F>
+  void run(size_t chunks, F const& f)
+  {
+    if (running == this)
+    {
+      for (size_t c = 0; c < chunks; ++c)
+        f(c);
+      return;
+    }
+
+    std::lock_guard job{run_mutex};
+    {
+      std::lock_guard lock{m};
+      task = [](void const* p, size_t c) { (*static_cast<F const*>(p))(c); };
+      ctx = &f;
+      n_chunks = chunks;
+      next.store(0, std::memory_order_relaxed);
+      pending = workers.size();
+      ++generation;
+    }
+    cv_start.notify_all();
+    {
+      Running in_pool{this};
+      drain();
+    }
+    std::unique_lock lock{m};
+    cv_done.wait(lock, [&] { return pending == 0; });
+    if (error)
+      std::rethrow_exception(std::exchange(error, nullptr));
+  }
+};
+
+// ================================================================================================
+// Policy
+// ================================================================================================
+
+// Parallel evaluation is off until `set_threads(n)` is called with `n > 1`.
+// Expressions shorter than the threshold always run on the calling thread,
+// where the cost of waking the pool (a few microseconds) would dominate.
+struct ParallelPolicy
+{
+  size_t threshold = size_t{1} << 18; // 2 MiB of doubles
+  std::unique_ptr<ThreadPool> pool;
+};
+
+inline ParallelPolicy& parallel_policy()
+{
+  static ParallelPolicy policy;
+  return policy;
+}
+
+// `n == 0` uses every hardware thread, `n == 1` turns parallel evaluation off.
+// Not to be called while another thread is evaluating an expression.
+inline void set_threads(size_t n)
+{
+  if (n == 0)
+    n = std::max(1u, std::thread::hardware_concurrency());
+  auto& pool = parallel_policy().pool;
+  pool.reset();
+  if (n > 1)
+    pool = std::make_unique<ThreadPool>(n);
+}
+
+inline size_t threads()
+{
+  auto const& pool = parallel_policy().pool;
+  return pool ? pool->size() : 1;
+}
+
+inline void set_parallel_threshold(size_t n)
+{
+  parallel_policy().threshold = n;
+}
+
+// Chunk boundaries are multiples of a cache line (8 doubles, 16 floats), so
+// two threads never write into the same line. A few chunks per thread even
+// out the load when some cores are busier than others.
+template <typename T>
+inline constexpr size_t chunk_granularity = 64 / sizeof(T);
+inline constexpr size_t chunks_per_thread = 4;
+
+// Evaluates `e` into `out[0, n)`. Each chunk runs the same fused, ISA
+// dispatched kernel over its own index range.
+template <typename T, typename E>
+void assign(T* out, E const& e, size_t n)
+{
+  constexpr size_t granularity = chunk_granularity<T>;
+
+  auto& policy = parallel_policy();
+  if (!policy.pool || n < policy.threshold)
+  {
+    dispatch(AssignKernel<E, T>{out, e, 0, n});
+    return;
+  }
+
+  size_t const chunks = policy.pool->size() * chunks_per_thread;
+  size_t chunk = (n + chunks - 1) / chunks;
+  chunk = (chunk + granularity - 1) / granularity * granularity;
+
+  policy.pool->run((n + chunk - 1) / chunk, [&](size_t c) {
+    size_t first = c * chunk;
+    size_t last = std::min(n, first + chunk);
+    dispatch(AssignKernel<E, T>{out, e, first, last});
+  });
+}
+
+} // namespace et
@@ -0,0 +1,296 @@
+/**
+ * @file:	et_reduce.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 16:40:00 Saturday
+ * @brief:	fused reductions consuming any `VecExpression` in a single pass
+ **/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "et_ops.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+// A reducer folds elements into an accumulator (`accumulate`) and folds two
+// accumulators together (`merge`), both on scalars and on packets.
+
+struct SumReducer
+{
+  static constexpr double identity = 0.0;
+
+  static double accumulate(double acc, double x) { return acc + x; }
+  static double merge(double a, double b) { return a + b; }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> accumulate(Packet<W> const& acc, Packet<W> const& x)
+  {
+    return acc + x;
+  }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> merge(Packet<W> const& a, Packet<W> const& b)
+  {
+    return a + b;
+  }
+};
+
+struct SumSquaresReducer
+{
+  static constexpr double identity = 0.0;
+
+  static double accumulate(double acc, double x) { return acc + x * x; }
+  static double merge(double a, double b) { return a + b; }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> accumulate(Packet<W> const& acc, Packet<W> const& x)
+  {
+    return acc + x * x;
+  }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> merge(Packet<W> const& a, Packet<W> const& b)
+  {
+    return a + b;
+  }
+};
+
+struct MinReducer
+{
+  static constexpr double identity = std::numeric_limits<double>::infinity();
+
+  static double accumulate(double acc, double x) { return x < acc ? x : acc; }
+  static double merge(double a, double b) { return accumulate(a, b); }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> accumulate(Packet<W> const& acc, Packet<W> const& x)
+  {
+    return min(acc, x);
+  }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> merge(Packet<W> const& a, Packet<W> const& b)
+  {
+    return min(a, b);
+  }
+};
+
+struct MaxReducer
+{
+  static constexpr double identity = -std::numeric_limits<double>::infinity();
+
+  static double accumulate(double acc, double x) { return x > acc ? x : acc; }
+  static double merge(double a, double b) { return accumulate(a, b); }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> accumulate(Packet<W> const& acc, Packet<W> const& x)
+  {
+    return max(acc, x);
+  }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> merge(Packet<W> const& a, Packet<W> const& b)
+  {
+    return max(a, b);
+  }
+};
+
+struct ProductReducer
+{
+  static constexpr double identity = 1.0;
+
+  static double accumulate(double acc, double x) { return acc * x; }
+  static double merge(double a, double b) { return a * b; }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> accumulate(Packet<W> const& acc, Packet<W> const& x)
+  {
+    return acc * x;
+  }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> merge(Packet<W> const& a, Packet<W> const& b)
+  {
+    return a * b;
+  }
+};
+
+// Number of independent packet accumulators. A single one would serialize
+// the loop on the latency of the add (4 cycles) instead of its throughput
+// (2 per cycle), four keep the FP units busy while still fitting in registers
+// for deep expressions.
+inline constexpr size_t reduce_accumulators = 4;
+
+// folds `e[first, last)`
+template <size_t W, typename R, typename E>
+ET_INLINE double reduce_packets(E const& e, size_t first, size_t last)
+{
+  constexpr size_t U = reduce_accumulators;
+
+  Packet<W> acc[U];
+  for (size_t u = 0; u < U; ++u)
+    acc[u] = Packet<W>::broadcast(R::identity);
+
+  size_t i = first;
+  for (; i + U * W <= last; i += U * W)
+    for (size_t u = 0; u < U; ++u)
+      acc[u] = R::accumulate(acc[u], e.template packet<W>(i + u * W));
+  for (; i + W <= last; i += W)
+    acc[0] = R::accumulate(acc[0], e.template packet<W>(i));
+
+  for (size_t u = 1; u < U; ++u)
+    acc[0] = R::merge(acc[0], acc[u]);
+
+  double r = R::identity;
+  for (size_t k = 0; k < W; ++k)
+    r = R::merge(r, acc[0].v[k]);
+  for (; i != last; ++i)
+    r = R::accumulate(r, e[i]);
+  return r;
+}
+
+template <typename R, typename E>
+struct ReduceKernel
+{
+  E const& e;
+  size_t first;
+  size_t last;
+
+  template <size_t W>
+  ET_INLINE double run() const
+  {
+    return reduce_packets<W, R>(e, first, last);
+  }
+};
+
+template <typename R, typename E>
+double reduce(VecExpression<E> const& expr)
+{
+  E const& e = static_cast<E const&>(expr);
+  return dispatch(ReduceKernel<R, E>{e, 0, e.size()});
+}
+
+// ================================================================================================
+// Entry points
+// ================================================================================================
+
+template <typename E>
+double sum(VecExpression<E> const& e)
+{
+  return reduce<SumReducer>(e);
+}
+
+// `u * v` is never materialized: its packets are fed straight to the sum.
+// With a sparse side, only its nonzeros are visited (see et_sparse.h).
+template <typename E1, typename E2>
+double dot(VecExpression<E1> const& u, VecExpression<E2> const& v)
+{
+  return sum(u * v);
+}
+
+template <typename E>
+double prod(VecExpression<E> const& e)
+{
+  return reduce<ProductReducer>(e);
+}
+
+// Euclidean norm. `e` is evaluated once per element, unlike `sqrt(dot(e, e))`.
+template <typename E>
+double norm2(VecExpression<E> const& e)
+{
+  return std::sqrt(reduce<SumSquaresReducer>(e));
+}
+
+// +inf for an empty expression
+template <typename E>
+double min(VecExpression<E> const& e)
+{
+  return reduce<MinReducer>(e);
+}
+
+// -inf for an empty expression
+template <typename E>
+double max(VecExpression<E> const& e)
+{
+  return reduce<MaxReducer>(e);
+}
+
+// ================================================================================================
+// argmax
+// ================================================================================================
+
+// Every lane keeps its own best value and the index it was seen at; updates
+// are selects, so the loop has no data-dependent branch. Lanes are merged at
+// the end, preferring the smallest index on ties like `std::max_element`.
+template <size_t W, typename E>
+ET_INLINE size_t argmax_packets(E const& e, size_t n)
+{
+  Packet<W> best = Packet<W>::broadcast(-std::numeric_limits<double>::infinity());
+  size_t where[W] = {};
+
+  size_t i = 0;
+  for (; i + W <= n; i += W)
+  {
+    Packet<W> p = e.template packet<W>(i);
+    for (size_t k = 0; k < W; ++k)
+    {
+      bool gt = p.v[k] > best.v[k];
+      best.v[k] = gt ? p.v[k] : best.v[k];
+      where[k] = gt ? i + k : where[k];
+    }
+  }
+
+  double best_value = best.v[0];
+  size_t best_index = where[0];
+  for (size_t k = 1; k < W; ++k)
+  {
+    if (best.v[k] > best_value ||
+        (best.v[k] == best_value && where[k] < best_index))
+    {
+      best_value = best.v[k];
+      best_index = where[k];
+    }
+  }
+
+  for (; i != n; ++i)
+  {
+    double x = e[i];
+    if (x > best_value)
+    {
+      best_value = x;
+      best_index = i;
+    }
+  }
+  return best_index;
+}
+
+template <typename E>
+struct ArgmaxKernel
+{
+  E const& e;
+  size_t n;
+
+  template <size_t W>
+  ET_INLINE size_t run() const
+  {
+    return argmax_packets<W>(e, n);
+  }
+};
+
+// index of the first maximum, `size()` for an empty expression
+template <typename E>
+size_t argmax(VecExpression<E> const& expr)
+{
+  E const& e = static_cast<E const&>(expr);
+  if (e.size() == 0)
+    return 0;
+  return dispatch(ArgmaxKernel<E>{e, e.size()});
+}
+
+} // namespace et
@@ -0,0 +1,268 @@
+/**
+ * @file:	et_rewrite.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 17:40:00 Saturday
+ * @brief:	compile-time rewriting of expression trees
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include "et_ops.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+// ================================================================================================
+// Nodes introduced by the rewrite rules
+// ================================================================================================
+
+// A constant known at compile time, so that `x * ones(n)` and `x + zeros(n)`
+// can be removed from the tree by `optimize`. It evaluates like `VecConst`.
+template <int V>
+class VecConstant : public VecExpression<VecConstant<V>>
+{
+  size_t _n;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  explicit VecConstant(size_t n) : _n{n} {}
+
+  double operator[](size_t) const { return V; }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t) const
+  {
+    return Packet<W>::broadcast(V);
+  }
+
+  size_t size() const { return _n; }
+
+  template <typename T>
+  bool reads_shifted(T const*, size_t) const
+  {
+    return false;
+  }
+};
+
+inline VecConstant<0> zeros(size_t n) { return VecConstant<0>(n); }
+
+inline VecConstant<1> ones(size_t n) { return VecConstant<1>(n); }
+
+// `a * b + c` with a single rounding on ISAs with FMA (see `packet_has_fma`).
+// Same storage rule as the other nodes: cref if leaf, copy otherwise.
+template <typename E1, typename E2, typename E3>
+class VecFma : public VecExpression<VecFma<E1, E2, E3>>
+{
+  typename std::conditional_t<E1::is_leaf, const E1&, const E1> _a;
+  typename std::conditional_t<E2::is_leaf, const E2&, const E2> _b;
+  typename std::conditional_t<E3::is_leaf, const E3&, const E3> _c;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  VecFma(E1 const& a, E2 const& b, E3 const& c) : _a(a), _b(b), _c(c)
+  {
+    check_size(a, b);
+    check_size(a, c);
+  }
+
+  double operator[](size_t i) const { return _a[i] * _b[i] + _c[i]; }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    return fma(
+        _a.template packet<W>(i), _b.template packet<W>(i),
+        _c.template packet<W>(i)
+    );
+  }
+
+  size_t size() const { return _c.size(); }
+
+  template <typename T>
+  bool reads_shifted(T const* out, size_t n) const
+  {
+    return _a.reads_shifted(out, n) || _b.reads_shifted(out, n) ||
+           _c.reads_shifted(out, n);
+  }
+};
+
+// ================================================================================================
+// Type predicates
+// ================================================================================================
+
+template <typename E, int V>
+inline constexpr bool is_constant = std::is_same_v<E, VecConstant<V>>;
+
+template <typename Op, typename E>
+inline constexpr bool is_binary = false;
+
+template <typename Op, typename E1, typename E2>
+inline constexpr bool is_binary<Op, VecBinary<Op, E1, E2>> = true;
+
+template <typename E>
+inline constexpr bool is_unary = false;
+
+template <typename Op, typename E>
+inline constexpr bool is_unary<VecUnary<Op, E>> = true;
+
+// ================================================================================================
+// Rewriting
+// ================================================================================================
+
+// `rewrite(e)` returns a leaf by reference (nodes built on top of it keep
+// referring to the original data) and any other node by value.
+template <typename E>
+decltype(auto) rewrite(E const& e);
+
+namespace detail
+{
+
+template <typename E>
+decltype(auto) keep(E const& e)
+{
+  if constexpr (E::is_leaf)
+    return (e);
+  else
+    return E(e);
+}
+
+template <typename T>
+using node_t = std::remove_cvref_t<T>;
+
+// A term of a sum chain, stored by reference if it is a leaf.
+template <typename E>
+auto term(E const& e)
+{
+  if constexpr (E::is_leaf)
+    return std::tuple<E const&>(e);
+  else
+    return std::tuple<E>(e);
+}
+
+// `(((a + b) + c) + d)` -> (a, b, c, d), with every term rewritten and every
+// `zeros(n)` term dropped
+template <typename E>
+auto flatten_sum(E const& e)
+{
+  if constexpr (is_binary<Plus, E>)
+    return std::tuple_cat(flatten_sum(e.lhs()), flatten_sum(e.rhs()));
+  else
+  {
+    decltype(auto) r = rewrite(e);
+    if constexpr (is_constant<node_t<decltype(r)>, 0>)
+      return std::tuple<>{};
+    else
+      return term(r);
+  }
+}
+
+// `a * b + c` and `c + a * b` become `fma(a, b, c)`
+template <typename L, typename R>
+auto make_sum(L const& l, R const& r)
+{
+  if constexpr (is_binary<Multiplies, L>)
+    return VecFma<node_t<decltype(l.lhs())>, node_t<decltype(l.rhs())>, R>(
+        l.lhs(), l.rhs(), r
+    );
+  else if constexpr (is_binary<Multiplies, R>)
+    return VecFma<node_t<decltype(r.lhs())>, node_t<decltype(r.rhs())>, L>(
+        r.lhs(), r.rhs(), l
+    );
+  else
+    return VecSum<L, R>(l, r);
+}
+
+// Terms `[First, First + Count)` summed as a balanced tree, whose depth is
+// log2(Count) instead of Count - 1: the partial sums are independent and
+// can be in flight at the same time.
+template <size_t First, size_t Count, typename Tuple>
+decltype(auto) build_sum(Tuple const& terms)
+{
+  if constexpr (Count == 1)
+    return std::get<First>(terms);
+  else
+  {
+    constexpr size_t Half = Count / 2;
+    return make_sum(
+        build_sum<First, Half>(terms),
+        build_sum<First + Half, Count - Half>(terms)
+    );
+  }
+}
+
+template <typename E>
+decltype(auto) rewrite_sum(E const& e)
+{
+  auto terms = flatten_sum(e);
+  constexpr size_t N = std::tuple_size_v<decltype(terms)>;
+  if constexpr (N == 0)
+    return zeros(e.size());
+  else
+    return keep(build_sum<0, N>(terms));
+}
+
+template <typename Op, typename E1, typename E2>
+decltype(auto) rewrite_binary(VecBinary<Op, E1, E2> const& e)
+{
+  decltype(auto) u = rewrite(e.lhs());
+  decltype(auto) v = rewrite(e.rhs());
+  using U = node_t<decltype(u)>;
+  using V = node_t<decltype(v)>;
+
+  if constexpr (std::is_same_v<Op, Multiplies> && is_constant<V, 1>)
+    return keep(u);
+  else if constexpr (std::is_same_v<Op, Multiplies> && is_constant<U, 1>)
+    return keep(v);
+  else if constexpr (std::is_same_v<Op, Minus> && is_constant<V, 0>)
+    return keep(u);
+  else
+    return VecBinary<Op, U, V>(u, v);
+}
+
+template <typename Op, typename E>
+auto rewrite_unary(VecUnary<Op, E> const& e)
+{
+  decltype(auto) u = rewrite(e.arg());
+  return VecUnary<Op, node_t<decltype(u)>>(u);
+}
+
+} // namespace detail
+
+template <typename E>
+decltype(auto) rewrite(E const& e)
+{
+  if constexpr (is_binary<Plus, E>)
+    return detail::rewrite_sum(e);
+  else if constexpr (
+      is_binary<Minus, E> || is_binary<Multiplies, E> || is_binary<Divides, E>
+  )
+    return detail::rewrite_binary(e);
+  else if constexpr (is_unary<E>)
+    return detail::rewrite_unary(e);
+  else
+    return detail::keep(e);
+}
+
+// Rewrites `expr` into an equivalent tree that is cheaper to evaluate:
+//
+// - `a * b + c` and `c + a * b` -> `VecFma`
+// - `x * ones(n)`, `ones(n) * x`, `x + zeros(n)`, `x - zeros(n)` -> `x`
+// - sum chains `a + b + c + d` -> balanced `(a + b) + (c + d)`
+//
+// Fusing and reassociating change the rounding of the result, which is why
+// this is opt-in: `Vec x = optimize(a * b + c + d);`
+template <typename E>
+decltype(auto) optimize(VecExpression<E> const& expr)
+{
+  return rewrite(static_cast<E const&>(expr));
+}
+
+} // namespace et
@@ -0,0 +1,190 @@
+/**
+ * @file:	et_scan.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 21:35:00 Saturday
+ * @brief:	inclusive / exclusive prefix scans of `VecExpression`s
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "et_parallel.h"
+#include "et_reduce.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+// A scan folds elements with a reducer of et_reduce.h and writes every
+// intermediate result: `inclusive_scan` stores `e[0] op ... op e[i]` at `i`,
+// `exclusive_scan` stores the fold of the elements before `i`. The reducer
+// maps an element into its accumulator as `accumulate(identity, x)`, so
+// `SumSquaresReducer` gives the running sum of squares and `MaxReducer` the
+// running maximum.
+//
+// Sums are reassociated (per packet, then per thread block), so the last bits
+// may differ from a sequential loop.
+
+// ================================================================================================
+// Kernel
+// ================================================================================================
+
+// Scans `e[first, last)` into `out[first, last)` starting from `carry`, and
+// returns the fold of the whole range including `carry`. Each packet is
+// scanned in registers with log2(W) shift-and-merge steps, then merged with
+// the running carry: the only dependency between packets is one merge.
+template <size_t W, typename R, bool Exclusive, typename E, typename T>
+ET_INLINE double
+scan_packets(T* out, E const& e, size_t first, size_t last, double carry)
+{
+  Packet<W> const identity = Packet<W>::broadcast(R::identity);
+  Packet<W> c = Packet<W>::broadcast(carry);
+
+  size_t i = first;
+  for (; i + W <= last; i += W)
+  {
+    Packet<W> p = R::accumulate(identity, e.template packet<W>(i));
+    for (size_t s = 1; s < W; s *= 2)
+    {
+      Packet<W> shifted = identity;
+      for (size_t k = s; k < W; ++k)
+        shifted.v[k] = p.v[k - s];
+      p = R::merge(p, shifted);
+    }
+
+    Packet<W> r = p;
+    if constexpr (Exclusive)
+    {
+      r = identity;
+      for (size_t k = 1; k < W; ++k)
+        r.v[k] = p.v[k - 1];
+    }
+    R::merge(c, r).store(out + i);
+    c = Packet<W>::broadcast(R::merge(c.v[0], p.v[W - 1]));
+  }
+
+  double acc = c.v[0];
+  for (; i != last; ++i)
+  {
+    double next = R::accumulate(acc, e[i]);
+    out[i] = static_cast<T>(Exclusive ? acc : next);
+    acc = next;
+  }
+  return acc;
+}
+
+template <typename R, bool Exclusive, typename E, typename T>
+struct ScanKernel
+{
+  T* out;
+  E const& e;
+  size_t first;
+  size_t last;
+  double carry;
+
+  template <size_t W>
+  ET_INLINE double run() const
+  {
+    return scan_packets<W, R, Exclusive>(out, e, first, last, carry);
+  }
+};
+
+// Sequential below the parallel threshold (see et_parallel.h). Above it, a
+// two-pass block scan: every thread folds its blocks, the block totals are
+// scanned (a handful of them), then every thread scans its blocks again from
+// their own carry. `e` is evaluated twice and never stored but in `out`.
+template <typename R, bool Exclusive, typename T, typename E>
+void scan(T* out, E const& e, size_t n, double init)
+{
+  constexpr size_t granularity = chunk_granularity<T>;
+
+  auto& policy = parallel_policy();
+  if (!policy.pool || n < policy.threshold)
+  {
+    dispatch(ScanKernel<R, Exclusive, E, T>{out, e, 0, n, init});
+    return;
+  }
+
+  size_t const chunks = policy.pool->size() * chunks_per_thread;
+  size_t chunk = (n + chunks - 1) / chunks;
+  chunk = (chunk + granularity - 1) / granularity * granularity;
+  size_t const blocks = (n + chunk - 1) / chunk;
+
+  std::vector<double> carry(blocks);
+  policy.pool->run(blocks, [&](size_t b) {
+    size_t first = b * chunk;
+    size_t last = std::min(n, first + chunk);
+    carry[b] = dispatch(ReduceKernel<R, E>{e, first, last});
+  });
+
+  double acc = init;
+  for (double& c : carry)
+    acc = R::merge(acc, std::exchange(c, acc));
+
+  policy.pool->run(blocks, [&](size_t b) {
+    size_t first = b * chunk;
+    size_t last = std::min(n, first + chunk);
+    dispatch(ScanKernel<R, Exclusive, E, T>{out, e, first, last, carry[b]});
+  });
+}
+
+// `out` is resized to `e`; element `i` of `e` is read before `out[i]` is
+// written, so `e` may refer to `out` at the same index, and is evaluated
+// through a temporary otherwise (see `reads_shifted`).
+template <typename R, bool Exclusive, typename E, typename T>
+void scan_into(E const& e, BasicVec<T>& out, double init)
+{
+  size_t const n = e.size();
+  if (out.size() != n || e.reads_shifted(out.data(), n))
+  {
+    BasicVec<T> r(n);
+    scan<R, Exclusive>(r.data(), e, n, init);
+    out = std::move(r);
+    return;
+  }
+  scan<R, Exclusive>(out.data(), e, n, init);
+}
+
+// ================================================================================================
+// Entry points
+// ================================================================================================
+
+// `out[i] = e[0] op e[1] op ... op e[i]`, a running sum by default:
+// `inclusive_scan(a * b, out)`, `inclusive_scan<MaxReducer>(a, out)`
+template <typename R = SumReducer, typename E, typename T>
+void inclusive_scan(VecExpression<E> const& e, BasicVec<T>& out)
+{
+  scan_into<R, false>(static_cast<E const&>(e), out, R::identity);
+}
+
+template <typename R = SumReducer, typename E>
+Vec inclusive_scan(VecExpression<E> const& e)
+{
+  Vec out;
+  inclusive_scan<R>(e, out);
+  return out;
+}
+
+// `out[0] = init`, `out[i] = init op e[0] op ... op e[i - 1]`
+template <typename R = SumReducer, typename E, typename T>
+void exclusive_scan(
+    VecExpression<E> const& e, BasicVec<T>& out, double init = R::identity
+)
+{
+  scan_into<R, true>(static_cast<E const&>(e), out, init);
+}
+
+template <typename R = SumReducer, typename E>
+Vec exclusive_scan(VecExpression<E> const& e, double init = R::identity)
+{
+  Vec out;
+  exclusive_scan<R>(e, out, init);
+  return out;
+}
+
+} // namespace et
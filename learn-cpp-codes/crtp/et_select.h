@@ -0,0 +1,240 @@
+/**
+ * @file:	et_select.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 21:10:00 Saturday
+ * @brief:	comparison masks, `select` and masked reductions without branches
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include "et_ops.h"
+#include "et_reduce.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+// A mask is an ordinary expression whose elements are 1.0 (true) or 0.0
+// (false), so it is stored, combined and reduced like any other; `select`
+// and the masked reductions treat every nonzero element as true.
+//
+// Every lane computes both sides and picks one with a compare and a blend,
+// so the data never decides which instruction runs next: no branch to
+// mispredict, whatever the pattern of the mask.
+
+// ================================================================================================
+// Comparisons and logic
+// ================================================================================================
+
+// A binary operation only needs the scalar `apply`: the default packet form
+// runs it on every lane, see `LaneWise` in et_ops.h.
+template <typename Derived>
+struct LaneWiseBinary
+{
+  template <size_t W>
+  ET_INLINE static Packet<W> apply(Packet<W> a, Packet<W> const& b)
+  {
+    for (size_t k = 0; k < W; ++k)
+      a.v[k] = Derived::apply(a.v[k], b.v[k]);
+    return a;
+  }
+};
+
+#define ET_MASK_OPERATION(Name, expr)                                          \
+  struct Name : LaneWiseBinary<Name>                                           \
+  {                                                                            \
+    using LaneWiseBinary::apply;                                               \
+    static double apply(double a, double b) { return (expr) ? 1.0 : 0.0; }    \
+  };
+
+ET_MASK_OPERATION(Less, a < b)
+ET_MASK_OPERATION(LessEqual, a <= b)
+ET_MASK_OPERATION(Greater, a > b)
+ET_MASK_OPERATION(GreaterEqual, a >= b)
+ET_MASK_OPERATION(EqualTo, a == b)
+ET_MASK_OPERATION(NotEqualTo, a != b)
+// `&` and `|` rather than `&&` and `||`: both sides are evaluated anyway
+ET_MASK_OPERATION(LogicalAnd, (a != 0.0) & (b != 0.0))
+ET_MASK_OPERATION(LogicalOr, (a != 0.0) | (b != 0.0))
+
+#undef ET_MASK_OPERATION
+
+struct LogicalNot : LaneWise<LogicalNot>
+{
+  using LaneWise::apply;
+  static double apply(double a) { return a == 0.0 ? 1.0 : 0.0; }
+};
+
+// `a < b`, `a >= 0.0`, `1.0 != b`, `(a > 0.0) && (b > 0.0)`
+#define ET_MASK_OPERATOR(op, Op)                                               \
+  template <typename E1, typename E2>                                          \
+  VecBinary<Op, E1, E2> operator op(                                           \
+      VecExpression<E1> const& u, VecExpression<E2> const& v                   \
+  )                                                                            \
+  {                                                                            \
+    return VecBinary<Op, E1, E2>(                                              \
+        *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)               \
+    );                                                                         \
+  }                                                                            \
+                                                                               \
+  template <typename E>                                                        \
+  VecBinary<Op, E, VecConst> operator op(VecExpression<E> const& u, double c)  \
+  {                                                                            \
+    return VecBinary<Op, E, VecConst>(                                         \
+        *static_cast<const E*>(&u), VecConst(c, u.size())                      \
+    );                                                                         \
+  }                                                                            \
+                                                                               \
+  template <typename E>                                                        \
+  VecBinary<Op, VecConst, E> operator op(double c, VecExpression<E> const& u)  \
+  {                                                                            \
+    return VecBinary<Op, VecConst, E>(                                         \
+        VecConst(c, u.size()), *static_cast<const E*>(&u)                      \
+    );                                                                         \
+  }
+
+ET_MASK_OPERATOR(<, Less)
+ET_MASK_OPERATOR(<=, LessEqual)
+ET_MASK_OPERATOR(>, Greater)
+ET_MASK_OPERATOR(>=, GreaterEqual)
+ET_MASK_OPERATOR(==, EqualTo)
+ET_MASK_OPERATOR(!=, NotEqualTo)
+ET_MASK_OPERATOR(&&, LogicalAnd)
+ET_MASK_OPERATOR(||, LogicalOr)
+
+#undef ET_MASK_OPERATOR
+
+template <typename E>
+VecUnary<LogicalNot, E> operator!(VecExpression<E> const& u)
+{
+  return VecUnary<LogicalNot, E>(*static_cast<const E*>(&u));
+}
+
+// ================================================================================================
+// select
+// ================================================================================================
+
+// `m[i] != 0 ? x[i] : y[i]`, both `x[i]` and `y[i]` being evaluated. Same
+// storage rule as the other nodes: cref if leaf, copy otherwise.
+template <typename M, typename E1, typename E2>
+class VecSelect : public VecExpression<VecSelect<M, E1, E2>>
+{
+  typename std::conditional_t<M::is_leaf, const M&, const M> _m;
+  typename std::conditional_t<E1::is_leaf, const E1&, const E1> _x;
+  typename std::conditional_t<E2::is_leaf, const E2&, const E2> _y;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  VecSelect(M const& m, E1 const& x, E2 const& y) : _m(m), _x(x), _y(y)
+  {
+    check_size(m, x);
+    check_size(m, y);
+  }
+
+  double operator[](size_t i) const
+  {
+    double x = _x[i], y = _y[i];
+    return _m[i] != 0.0 ? x : y;
+  }
+
+  // a compare and a blend per packet
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    Packet<W> m = _m.template packet<W>(i);
+    Packet<W> x = _x.template packet<W>(i);
+    Packet<W> y = _y.template packet<W>(i);
+    for (size_t k = 0; k < W; ++k)
+      y.v[k] = m.v[k] != 0.0 ? x.v[k] : y.v[k];
+    return y;
+  }
+
+  size_t size() const { return _m.size(); }
+
+  template <typename T>
+  bool reads_shifted(T const* out, size_t n) const
+  {
+    return _m.reads_shifted(out, n) || _x.reads_shifted(out, n) ||
+           _y.reads_shifted(out, n);
+  }
+};
+
+// Either branch may be a scalar: `select(a < 0.0, 0.0, a)`.
+namespace detail
+{
+
+template <typename E>
+E const& operand(VecExpression<E> const& e, size_t)
+{
+  return static_cast<E const&>(e);
+}
+
+inline VecConst operand(double c, size_t n) { return VecConst(c, n); }
+
+template <typename T>
+using operand_t =
+    std::remove_cvref_t<decltype(operand(std::declval<T const&>(), 0))>;
+
+} // namespace detail
+
+template <typename M, typename X, typename Y>
+auto select(VecExpression<M> const& mask, X const& x, Y const& y)
+    -> VecSelect<M, detail::operand_t<X>, detail::operand_t<Y>>
+{
+  size_t const n = mask.size();
+  return {
+      static_cast<M const&>(mask), detail::operand(x, n),
+      detail::operand(y, n)
+  };
+}
+
+// ================================================================================================
+// Masked reductions
+// ================================================================================================
+
+struct CountReducer
+{
+  static constexpr double identity = 0.0;
+
+  static double accumulate(double acc, double x)
+  {
+    return acc + (x != 0.0 ? 1.0 : 0.0);
+  }
+  static double merge(double a, double b) { return a + b; }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> accumulate(Packet<W> acc, Packet<W> const& x)
+  {
+    for (size_t k = 0; k < W; ++k)
+      acc.v[k] += x.v[k] != 0.0 ? 1.0 : 0.0;
+    return acc;
+  }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> merge(Packet<W> const& a, Packet<W> const& b)
+  {
+    return a + b;
+  }
+};
+
+// number of true (nonzero) elements of a mask
+template <typename M>
+size_t count_if(VecExpression<M> const& mask)
+{
+  return static_cast<size_t>(reduce<CountReducer>(mask));
+}
+
+// sum of `x[i]` where `mask[i]` is true; a NaN or an infinity outside the
+// mask is not picked, unlike with `sum(mask * x)`
+template <typename M, typename E>
+double sum_if(VecExpression<M> const& mask, VecExpression<E> const& x)
+{
+  return reduce<SumReducer>(select(mask, x, 0.0));
+}
+
+} // namespace et
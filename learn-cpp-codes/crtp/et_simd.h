@@ -0,0 +1,270 @@
+/**
+ * @file:	et_simd.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 15:45:00 Saturday
+ * @brief:	packets of doubles & runtime ISA dispatch for expression templates
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+// Every packet operation has to be inlined into the kernel that is compiled
+// for the selected ISA (see `dispatch` below), otherwise it would be emitted for
+// the baseline target and lose the wide registers.
+#if defined(__GNUC__)
+#define ET_INLINE [[gnu::always_inline]] inline
+#else
+#define ET_INLINE inline
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ET_X86_DISPATCH 1
+#else
+#define ET_X86_DISPATCH 0
+#endif
+
+namespace et
+{
+
+// Whether the kernels running W lanes have a fused multiply-add instruction:
+// the AVX2 kernel is built with FMA and AVX-512F includes it, while the SSE2
+// one would fall back to a (slow) software `fma`.
+template <size_t W>
+inline constexpr bool packet_has_fma =
+#if ET_X86_DISPATCH
+    W >= 4;
+#elif defined(__FP_FAST_FMA)
+    true;
+#else
+    false;
+#endif
+
+// A `Packet<W>` is W consecutive doubles processed as one value. It is a plain
+// array on purpose: compiler vector types change the calling convention with
+// the target ISA, while a lane loop over an array is turned into a single
+// SSE2/AVX2/AVX-512 instruction once inlined into a kernel of that ISA.
+template <size_t W>
+struct Packet
+{
+  double v[W];
+
+  ET_INLINE static Packet broadcast(double x)
+  {
+    Packet r;
+    for (size_t k = 0; k < W; ++k)
+      r.v[k] = x;
+    return r;
+  }
+
+  // A lane loop rather than a memcpy: with the default tuning GCC splits an
+  // unaligned 256-bit memcpy into two 128-bit loads spilled to the stack, and
+  // the wide reload of the spill stalls on store forwarding every packet.
+  // Narrower storage (float, bfloat16, ...) is widened lane by lane, which
+  // compiles to a single conversion instruction for float.
+  template <typename T>
+  ET_INLINE static Packet load(T const* p)
+  {
+    Packet r;
+    for (size_t k = 0; k < W; ++k)
+      r.v[k] = static_cast<double>(p[k]);
+    return r;
+  }
+
+  ET_INLINE void store(double* p) const { std::memcpy(p, v, sizeof(v)); }
+
+  template <typename T>
+  ET_INLINE void store(T* p) const
+  {
+    for (size_t k = 0; k < W; ++k)
+      p[k] = static_cast<T>(v[k]);
+  }
+
+  ET_INLINE friend Packet operator+(Packet a, Packet const& b)
+  {
+    for (size_t k = 0; k < W; ++k)
+      a.v[k] += b.v[k];
+    return a;
+  }
+
+  ET_INLINE friend Packet operator-(Packet a, Packet const& b)
+  {
+    for (size_t k = 0; k < W; ++k)
+      a.v[k] -= b.v[k];
+    return a;
+  }
+
+  ET_INLINE friend Packet operator*(Packet a, Packet const& b)
+  {
+    for (size_t k = 0; k < W; ++k)
+      a.v[k] *= b.v[k];
+    return a;
+  }
+
+  ET_INLINE friend Packet operator/(Packet a, Packet const& b)
+  {
+    for (size_t k = 0; k < W; ++k)
+      a.v[k] /= b.v[k];
+    return a;
+  }
+
+  // a * b + c, rounded once where the ISA allows it
+  ET_INLINE friend Packet fma(Packet const& a, Packet const& b, Packet c)
+  {
+    for (size_t k = 0; k < W; ++k)
+    {
+      if constexpr (packet_has_fma<W>)
+        c.v[k] = __builtin_fma(a.v[k], b.v[k], c.v[k]);
+      else
+        c.v[k] = a.v[k] * b.v[k] + c.v[k];
+    }
+    return c;
+  }
+
+  // written as selects so that they map onto `minpd` / `maxpd`
+  ET_INLINE friend Packet min(Packet a, Packet const& b)
+  {
+    for (size_t k = 0; k < W; ++k)
+      a.v[k] = b.v[k] < a.v[k] ? b.v[k] : a.v[k];
+    return a;
+  }
+
+  ET_INLINE friend Packet max(Packet a, Packet const& b)
+  {
+    for (size_t k = 0; k < W; ++k)
+      a.v[k] = b.v[k] > a.v[k] ? b.v[k] : a.v[k];
+    return a;
+  }
+};
+
+// Instruction sets a kernel can be built for. `generic` is the portable path
+// (2 lanes, e.g. NEON) used on non-x86 targets.
+enum class Isa
+{
+  generic,
+  sse2,
+  avx2,
+  avx512
+};
+
+inline const char* isa_name(Isa isa)
+{
+  switch (isa)
+  {
+  case Isa::sse2:
+    return "sse2";
+  case Isa::avx2:
+    return "avx2";
+  case Isa::avx512:
+    return "avx512";
+  default:
+    return "generic";
+  }
+}
+
+// widest instruction set supported by the running CPU
+inline Isa detect_isa()
+{
+#if ET_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return Isa::avx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return Isa::avx2;
+  return Isa::sse2;
+#else
+  return Isa::generic;
+#endif
+}
+
+// The selected ISA is detected once and can be lowered afterwards, e.g. to
+// compare the widths against each other in one binary. Raising it above what
+// `detect_isa()` reports is ignored.
+inline Isa& active_isa_ref()
+{
+  static Isa isa = detect_isa();
+  return isa;
+}
+
+inline Isa active_isa() { return active_isa_ref(); }
+
+inline void set_isa(Isa isa)
+{
+  if (static_cast<int>(isa) <= static_cast<int>(detect_isa()))
+    active_isa_ref() = isa;
+}
+
+// A kernel is a functor whose `template <size_t W> run()` does the work W
+// lanes at a time. `dispatch` instantiates it once per ISA, inside a function
+// compiled for that ISA, and calls the widest one supported by the machine.
+#if ET_X86_DISPATCH
+
+template <typename Kernel>
+auto run_sse2(Kernel const& k)
+{
+  return k.template run<2>();
+}
+
+template <typename Kernel>
+[[gnu::target("avx2,fma")]] auto run_avx2(Kernel const& k)
+{
+  return k.template run<4>();
+}
+
+template <typename Kernel>
+[[gnu::target("avx512f")]] auto run_avx512(Kernel const& k)
+{
+  return k.template run<8>();
+}
+
+#endif
+
+template <typename Kernel>
+auto dispatch(Kernel const& k)
+{
+#if ET_X86_DISPATCH
+  switch (active_isa())
+  {
+  case Isa::avx512:
+    return run_avx512(k);
+  case Isa::avx2:
+    return run_avx2(k);
+  default:
+    return run_sse2(k);
+  }
+#else
+  return k.template run<2>();
+#endif
+}
+
+// Evaluates `e` into `out[first, last)`, W lanes at a time plus a scalar
+// tail. `E` is the concrete expression type, which provides `packet<W>(i)` and
+// `[]`. Elements are computed in double and stored as `T`.
+template <size_t W, typename E, typename T>
+ET_INLINE void assign_packets(T* out, E const& e, size_t first, size_t last)
+{
+  size_t i = first;
+  for (; i + W <= last; i += W)
+    e.template packet<W>(i).store(out + i);
+  for (; i != last; ++i)
+    out[i] = static_cast<T>(e[i]);
+}
+
+// `assign` itself (serial or chunked over threads) lives in et_parallel.h
+template <typename E, typename T = double>
+struct AssignKernel
+{
+  T* out;
+  E const& e;
+  size_t first;
+  size_t last;
+
+  template <size_t W>
+  ET_INLINE void run() const
+  {
+    assign_packets<W>(out, e, first, last);
+  }
+};
+
+} // namespace et
@@ -0,0 +1,453 @@
+/**
+ * @file:	et_sparse.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 19:50:00 Saturday
+ * @brief:	sparse vector leaf and expressions walking only its nonzeros
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "et_ops.h"
+#include "et_parallel.h"
+#include "et_reduce.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+class SparseVec;
+
+// ================================================================================================
+// Sparse expressions
+// ================================================================================================
+
+// An expression is sparse when it is zero wherever all of its sparse leaves
+// are: sums and differences of sparse operands, products with at least one
+// sparse operand, quotients by a scalar, and unary operations keeping zero at
+// zero. As in other sparse libraries, an implicit zero times anything stays
+// zero, even times an infinity.
+template <typename E>
+inline constexpr bool is_sparse = false;
+
+template <>
+inline constexpr bool is_sparse<SparseVec> = true;
+
+template <typename Op, typename E1, typename E2>
+inline constexpr bool is_sparse<VecBinary<Op, E1, E2>> =
+    ((std::is_same_v<Op, Plus> || std::is_same_v<Op, Minus>) &&
+     is_sparse<E1> && is_sparse<E2>) ||
+    (std::is_same_v<Op, Multiplies> && (is_sparse<E1> || is_sparse<E2>)) ||
+    (std::is_same_v<Op, Divides> && is_sparse<E1> &&
+     std::is_same_v<E2, VecConst>);
+
+template <typename Op, typename E>
+inline constexpr bool is_sparse<VecUnary<Op, E>> =
+    is_sparse<E> && (std::is_same_v<Op, Negate> || std::is_same_v<Op, Abs> ||
+                     std::is_same_v<Op, Sqrt>);
+
+// A sparse expression is walked by a cursor over its nonzeros, in increasing
+// index order: `valid()`, `index()`, `value()`, `next()`. Cursors nest like
+// the nodes they walk, so `s + 2.0 * t` merges the index lists of `s` and `t`
+// in one pass and never looks at the zeros in between.
+
+// nonzeros of a leaf
+class SparseCursor
+{
+  size_t const* _i;
+  size_t const* _end;
+  double const* _v;
+
+public:
+  SparseCursor(size_t const* i, size_t const* end, double const* v)
+      : _i{i}, _end{end}, _v{v}
+  {
+  }
+
+  bool valid() const { return _i != _end; }
+  size_t index() const { return *_i; }
+  double value() const { return *_v; }
+
+  void next()
+  {
+    ++_i;
+    ++_v;
+  }
+};
+
+// `a op b` with both sides sparse and `op(0, 0) == 0`: union of the indices
+template <typename Op, typename C1, typename C2>
+class UnionCursor
+{
+  C1 _a;
+  C2 _b;
+
+  bool at_a(size_t k) const { return _a.valid() && _a.index() == k; }
+  bool at_b(size_t k) const { return _b.valid() && _b.index() == k; }
+
+public:
+  UnionCursor(C1 a, C2 b) : _a{std::move(a)}, _b{std::move(b)} {}
+
+  bool valid() const { return _a.valid() || _b.valid(); }
+
+  size_t index() const
+  {
+    if (!_b.valid() || (_a.valid() && _a.index() < _b.index()))
+      return _a.index();
+    return _b.index();
+  }
+
+  double value() const
+  {
+    size_t k = index();
+    return Op::apply(at_a(k) ? _a.value() : 0.0, at_b(k) ? _b.value() : 0.0);
+  }
+
+  void next()
+  {
+    size_t k = index();
+    bool a = at_a(k), b = at_b(k);
+    if (a)
+      _a.next();
+    if (b)
+      _b.next();
+  }
+};
+
+// `a * b` with both sides sparse: intersection of the indices
+template <typename Op, typename C1, typename C2>
+class IntersectionCursor
+{
+  C1 _a;
+  C2 _b;
+
+  void align()
+  {
+    while (_a.valid() && _b.valid() && _a.index() != _b.index())
+    {
+      if (_a.index() < _b.index())
+        _a.next();
+      else
+        _b.next();
+    }
+  }
+
+public:
+  IntersectionCursor(C1 a, C2 b) : _a{std::move(a)}, _b{std::move(b)}
+  {
+    align();
+  }
+
+  bool valid() const { return _a.valid() && _b.valid(); }
+  size_t index() const { return _a.index(); }
+  double value() const { return Op::apply(_a.value(), _b.value()); }
+
+  void next()
+  {
+    _a.next();
+    _b.next();
+    align();
+  }
+};
+
+// a sparse side combined with a dense one, read at the nonzeros only
+template <typename Op, typename C, typename E, bool SparseLeft>
+class MixedCursor
+{
+  C _c;
+  E const& _e;
+
+public:
+  MixedCursor(C c, E const& e) : _c{std::move(c)}, _e{e} {}
+
+  bool valid() const { return _c.valid(); }
+  size_t index() const { return _c.index(); }
+
+  double value() const
+  {
+    if constexpr (SparseLeft)
+      return Op::apply(_c.value(), _e[_c.index()]);
+    else
+      return Op::apply(_e[_c.index()], _c.value());
+  }
+
+  void next() { _c.next(); }
+};
+
+template <typename Op, typename C>
+class MapCursor
+{
+  C _c;
+
+public:
+  explicit MapCursor(C c) : _c{std::move(c)} {}
+
+  bool valid() const { return _c.valid(); }
+  size_t index() const { return _c.index(); }
+  double value() const { return Op::apply(_c.value()); }
+  void next() { _c.next(); }
+};
+
+SparseCursor nonzeros(SparseVec const& s);
+
+// The cursors refer to the nodes of `e`, which must outlive them.
+template <typename Op, typename E1, typename E2>
+auto nonzeros(VecBinary<Op, E1, E2> const& e)
+{
+  static_assert(is_sparse<VecBinary<Op, E1, E2>>, "not a sparse expression");
+
+  if constexpr (is_sparse<E1> && is_sparse<E2>)
+  {
+    using C1 = decltype(nonzeros(e.lhs()));
+    using C2 = decltype(nonzeros(e.rhs()));
+    if constexpr (std::is_same_v<Op, Multiplies>)
+      return IntersectionCursor<Op, C1, C2>(nonzeros(e.lhs()), nonzeros(e.rhs()));
+    else
+      return UnionCursor<Op, C1, C2>(nonzeros(e.lhs()), nonzeros(e.rhs()));
+  }
+  else if constexpr (is_sparse<E1>)
+    return MixedCursor<Op, decltype(nonzeros(e.lhs())), E2, true>(
+        nonzeros(e.lhs()), e.rhs()
+    );
+  else
+    return MixedCursor<Op, decltype(nonzeros(e.rhs())), E1, false>(
+        nonzeros(e.rhs()), e.lhs()
+    );
+}
+
+template <typename Op, typename E>
+auto nonzeros(VecUnary<Op, E> const& e)
+{
+  static_assert(is_sparse<VecUnary<Op, E>>, "not a sparse expression");
+  return MapCursor<Op, decltype(nonzeros(e.arg()))>(nonzeros(e.arg()));
+}
+
+// ================================================================================================
+// Leaf
+// ================================================================================================
+
+// A vector of `size()` elements of which only `nnz()` are stored, as sorted
+// indices and their values. It is a leaf like `Vec` and takes part in any
+// expression, where dense nodes see the zeros in between (a binary search per
+// packet). Expressions built only from sparse leaves (see `is_sparse`) are
+// evaluated by merging index lists instead, into a `SparseVec` or a `Vec`.
+class SparseVec : public VecExpression<SparseVec>
+{
+  size_t n = 0;
+  std::vector<size_t> idx;
+  std::vector<double> val;
+
+  size_t lower_bound(size_t i) const
+  {
+    return static_cast<size_t>(
+        std::lower_bound(idx.begin(), idx.end(), i) - idx.begin()
+    );
+  }
+
+public:
+  static constexpr bool is_leaf = true;
+
+  SparseVec() = default;
+
+  // all zeros
+  explicit SparseVec(size_t size) : n{size} {}
+
+  // `indices` strictly increasing and below `size`
+  SparseVec(size_t size, std::vector<size_t> indices, std::vector<double> values)
+      : n{size}, idx{std::move(indices)}, val{std::move(values)}
+  {
+    if (idx.size() != val.size())
+      throw std::invalid_argument("SparseVec indices and values differ in size");
+    for (size_t k = 0; k < idx.size(); ++k)
+      if (idx[k] >= n || (k > 0 && idx[k] <= idx[k - 1]))
+        throw std::invalid_argument("SparseVec indices must increase below size");
+  }
+
+  // Evaluates a sparse expression by walking its nonzeros, or scans any
+  // other expression for its nonzero elements. Exact zeros are not stored.
+  template <typename E>
+  SparseVec(VecExpression<E> const& expr);
+
+  template <typename E>
+  SparseVec& operator=(VecExpression<E> const& expr)
+  {
+    return *this = SparseVec(expr);
+  }
+
+  // appends a nonzero after the last one
+  void push_back(size_t i, double value)
+  {
+    if (i >= n || (!idx.empty() && i <= idx.back()))
+      throw std::invalid_argument("SparseVec indices must increase below size");
+    idx.push_back(i);
+    val.push_back(value);
+  }
+
+  void reserve(size_t nonzeros)
+  {
+    idx.reserve(nonzeros);
+    val.reserve(nonzeros);
+  }
+
+  double operator[](size_t i) const
+  {
+    size_t k = lower_bound(i);
+    return k != idx.size() && idx[k] == i ? val[k] : 0.0;
+  }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    Packet<W> r = Packet<W>::broadcast(0.0);
+    for (size_t k = lower_bound(i); k != idx.size() && idx[k] < i + W; ++k)
+      r.v[idx[k] - i] = val[k];
+    return r;
+  }
+
+  size_t size() const { return n; }
+  size_t nnz() const { return idx.size(); }
+
+  // owns its storage, no dense destination can overlap it
+  template <typename T>
+  bool reads_shifted(T const*, size_t) const
+  {
+    return false;
+  }
+
+  std::vector<size_t> const& indices() const { return idx; }
+  std::vector<double> const& values() const { return val; }
+
+  SparseCursor cursor() const
+  {
+    return SparseCursor(idx.data(), idx.data() + idx.size(), val.data());
+  }
+};
+
+inline SparseCursor nonzeros(SparseVec const& s) { return s.cursor(); }
+
+template <typename E>
+SparseVec::SparseVec(VecExpression<E> const& expr) : n{expr.size()}
+{
+  E const& e = static_cast<E const&>(expr);
+  if constexpr (is_sparse<E>)
+  {
+    for (auto c = nonzeros(e); c.valid(); c.next())
+      if (double x = c.value(); x != 0.0)
+      {
+        idx.push_back(c.index());
+        val.push_back(x);
+      }
+  }
+  else
+  {
+    for (size_t i = 0; i != n; ++i)
+      if (double x = e[i]; x != 0.0)
+      {
+        idx.push_back(i);
+        val.push_back(x);
+      }
+  }
+}
+
+// ================================================================================================
+// Dense destinations
+// ================================================================================================
+
+// These overloads of `assign` (et_parallel.h) are found by `BasicVec` and the
+// compound operators through ADL. Each element is written right after it is
+// read, in increasing order, so they keep the aliasing guarantee of the
+// packet kernels and run on the calling thread.
+
+// sparse expression into dense storage: zeros between its nonzeros
+template <typename T, typename E>
+  requires is_sparse<E>
+void assign(T* out, E const& e, size_t n)
+{
+  size_t i = 0;
+  for (auto c = nonzeros(e); c.valid(); c.next())
+  {
+    size_t k = c.index();
+    std::fill(out + i, out + k, static_cast<T>(0.0));
+    out[k] = static_cast<T>(c.value());
+    i = k + 1;
+  }
+  std::fill(out + i, out + n, static_cast<T>(0.0));
+}
+
+// `dense + sparse`, `sparse + dense` and `dense - sparse`: the runs between
+// nonzeros are plain copies of the dense side, evaluated by the packet
+// kernel; `v += alpha * s` does not even copy, it only touches the nonzeros.
+template <typename T, typename Op, typename E1, typename E2>
+  requires(
+      !is_sparse<VecBinary<Op, E1, E2>> && (is_sparse<E1> || is_sparse<E2>) &&
+      (std::is_same_v<Op, Plus> ||
+       (std::is_same_v<Op, Minus> && is_sparse<E2>))
+  )
+void assign(T* out, VecBinary<Op, E1, E2> const& e, size_t n)
+{
+  constexpr bool sparse_left = is_sparse<E1>;
+  auto const& d = [&]() -> auto const& {
+    if constexpr (sparse_left)
+      return e.rhs();
+    else
+      return e.lhs();
+  }();
+  auto c = [&] {
+    if constexpr (sparse_left)
+      return nonzeros(e.lhs());
+    else
+      return nonzeros(e.rhs());
+  }();
+
+  using D = std::remove_cvref_t<decltype(d)>;
+  bool in_place = false;
+  if constexpr (std::is_same_v<D, BasicVec<T>>)
+    in_place = d.data() == out;
+
+  size_t i = 0;
+  for (; c.valid(); c.next())
+  {
+    size_t k = c.index();
+    if (!in_place && i != k)
+      dispatch(AssignKernel<D, T>{out, d, i, k});
+    double x = sparse_left ? Op::apply(c.value(), d[k]) : Op::apply(d[k], c.value());
+    out[k] = static_cast<T>(x);
+    i = k + 1;
+  }
+  if (!in_place && i != n)
+    dispatch(AssignKernel<D, T>{out, d, i, n});
+}
+
+// ================================================================================================
+// Reductions over nonzeros, preferred over et_reduce.h for sparse expressions
+// ================================================================================================
+
+template <typename E>
+  requires is_sparse<E>
+double sum(VecExpression<E> const& expr)
+{
+  double r = 0.0;
+  for (auto c = nonzeros(static_cast<E const&>(expr)); c.valid(); c.next())
+    r += c.value();
+  return r;
+}
+
+template <typename E>
+  requires is_sparse<E>
+double norm2(VecExpression<E> const& expr)
+{
+  double r = 0.0;
+  for (auto c = nonzeros(static_cast<E const&>(expr)); c.valid(); c.next())
+    r += c.value() * c.value();
+  return std::sqrt(r);
+}
+
+} // namespace et
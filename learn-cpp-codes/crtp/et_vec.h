@@ -0,0 +1,370 @@
+/**
+ * @file:	et_vec.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 15:20:00 Saturday
+ * @brief:	expression templates core: `VecExpression`, `Vec` & `VecSum`
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "et_parallel.h"
+#include "et_simd.h"
+
+namespace et
+{
+
+// A base class `VecExpression` represents any vector-valued expression. It is
+// templated on the actual expression type `E` to be implemented, per the
+// _curiously recurring template pattern_. The existence of a base class like
+// `VecExpression` is not strictly necessary for expression templates to work.
+// It will merely serve as a function argument type to distinguish the
+// expressions from other types (note the definition of a `Vec` constructor and
+// `operator+` below).
+
+template <typename E>
+class VecExpression
+{
+public:
+  static constexpr bool is_leaf = false;
+
+  double operator[](size_t i) const
+  {
+    // Delegation to the actual expression type. This avoids dynamic
+    // polymorphism (a.k.a. virtual functions in C++)
+    return static_cast<E const&>(*this)[i];
+  }
+
+  // W consecutive elements starting at `i`, see `Packet` in et_simd.h
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    return static_cast<E const&>(*this).template packet<W>(i);
+  }
+
+  size_t size() const { return static_cast<E const&>(*this).size(); }
+
+  // Whether evaluating the expression into `out[0, n)` would read an element
+  // of that range at an index other than the one being written. Reading
+  // `out[i]` while writing `out[i]` is fine, reading `out[i + 1]` is not.
+  template <typename T>
+  bool reads_shifted(T const* out, size_t n) const
+  {
+    return static_cast<E const&>(*this).reads_shifted(out, n);
+  }
+};
+
+// `[p, p + n)` overlaps `[out, out + len)` other than element for element,
+// i.e. not starting at `out` or not with the same element type
+template <typename T, typename U>
+bool overlaps_shifted(T const* p, size_t n, U const* out, size_t len)
+{
+  auto a = reinterpret_cast<std::uintptr_t>(p);
+  auto b = reinterpret_cast<std::uintptr_t>(out);
+  bool overlap = a < b + len * sizeof(U) && b < a + n * sizeof(T);
+  return overlap && !(std::is_same_v<T, U> && a == b);
+}
+
+// Sizes are only known at runtime, so every node combining two operands checks
+// them once when it is built. The check costs one comparison per node, never
+// one per element.
+template <typename E1, typename E2>
+void check_size(VecExpression<E1> const& u, VecExpression<E2> const& v)
+{
+  if (u.size() != v.size())
+    throw std::length_error(
+        "VecExpression size mismatch: " + std::to_string(u.size()) +
+        " vs " + std::to_string(v.size())
+    );
+}
+
+// Storage of a `Vec` is 64-byte aligned (one cache line, one AVX-512
+// register), so that a pass over it never splits a load across lines.
+inline constexpr size_t vec_alignment = 64;
+
+template <typename T>
+struct AlignedDelete
+{
+  void operator()(T* p) const
+  {
+    ::operator delete(p, std::align_val_t{vec_alignment});
+  }
+};
+
+template <typename T>
+using AlignedArray = std::unique_ptr<T[], AlignedDelete<T>>;
+
+using AlignedBuffer = AlignedArray<double>;
+
+// elements are left uninitialized, callers are expected to overwrite them
+template <typename T = double>
+AlignedArray<T> allocate_aligned(size_t n)
+{
+  static_assert(std::is_trivially_default_constructible_v<T>);
+  if (n == 0)
+    return AlignedArray<T>{};
+  return AlignedArray<T>{static_cast<T*>(
+      ::operator new(n * sizeof(T), std::align_val_t{vec_alignment})
+  )};
+}
+
+// ================================================================================================
+// Storage types
+// ================================================================================================
+
+// Expressions always compute in double; a leaf only decides how its elements
+// are stored. Narrower storage moves fewer bytes, which is what bounds most
+// passes over large vectors: float halves the traffic, bfloat16 (the upper 16
+// bits of a float: same range, 8 bits of mantissa) quarters it.
+struct bfloat16
+{
+  uint16_t bits;
+
+  bfloat16() = default;
+
+  // round to nearest even, NaN stays a (quiet) NaN
+  explicit bfloat16(float f)
+  {
+    auto u = std::bit_cast<uint32_t>(f);
+    if ((u & 0x7fffffffu) > 0x7f800000u)
+      bits = static_cast<uint16_t>((u >> 16) | 0x40u);
+    else
+      bits = static_cast<uint16_t>((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+  }
+
+  operator float() const
+  {
+    return std::bit_cast<float>(static_cast<uint32_t>(bits) << 16);
+  }
+};
+
+// The boolean `is_leaf` is there to tag `VecExpression`s that are '"leafs",
+// i.e. that actually contain data. The `Vec` class is a leaf that stores the
+// coordinates of a fully evaluated vector expression, and becomes a subclass of
+// `VecExpression`. Its length is chosen at runtime and its elements live in a
+// single aligned heap block, hence `Vec x = a + b + c` over millions of
+// elements is still one pass with no intermediate buffers.
+//
+// `BasicVec<T>` stores its elements as `T` and is read and written as double:
+// `BasicVec<float>` leaves are widened when loaded, results are narrowed when
+// stored, and reductions over them accumulate in double.
+
+template <typename T>
+class BasicVec : public VecExpression<BasicVec<T>>
+{
+  size_t n = 0;
+  AlignedArray<T> elems;
+
+public:
+  static constexpr bool is_leaf = true;
+
+  using value_type = T;
+
+  BasicVec() = default;
+
+  explicit BasicVec(size_t size, double value = 0.0)
+      : n{size}, elems{allocate_aligned<T>(size)}
+  {
+    std::fill_n(elems.get(), n, static_cast<T>(value));
+  }
+
+  // construct Vec using initializer list
+  BasicVec(std::initializer_list<double> init)
+      : n{init.size()}, elems{allocate_aligned<T>(init.size())}
+  {
+    std::transform(init.begin(), init.end(), elems.get(), [](double x) {
+      return static_cast<T>(x);
+    });
+  }
+
+  BasicVec(BasicVec const& other)
+      : n{other.n}, elems{allocate_aligned<T>(other.n)}
+  {
+    std::copy_n(other.elems.get(), n, elems.get());
+  }
+
+  BasicVec(BasicVec&& other) noexcept
+      : n{std::exchange(other.n, 0)}, elems{std::move(other.elems)}
+  {
+  }
+
+  BasicVec& operator=(BasicVec const& other)
+  {
+    if (this != &other)
+    {
+      if (n != other.n)
+      {
+        elems = allocate_aligned<T>(other.n);
+        n = other.n;
+      }
+      std::copy_n(other.elems.get(), n, elems.get());
+    }
+    return *this;
+  }
+
+  BasicVec& operator=(BasicVec&& other) noexcept
+  {
+    n = std::exchange(other.n, 0);
+    elems = std::move(other.elems);
+    return *this;
+  }
+
+  // A Vec can be constructed from any VecExpression, forcing its evaluation.
+  // The buffer is allocated uninitialized and written exactly once, packet by
+  // packet, by the kernel matching the running CPU and, for long vectors when
+  // enabled, by several threads (see `assign` in et_parallel.h).
+  template <typename E>
+  BasicVec(VecExpression<E> const& expr)
+      : n{expr.size()}, elems{allocate_aligned<T>(expr.size())}
+  {
+    assign(elems.get(), static_cast<E const&>(expr), n);
+  }
+
+  // Assigning an expression reuses the current buffer when sizes agree. The
+  // nodes read the elements of packet `i` only, so storing that packet right
+  // after is safe even when the expression refers to `*this`, unless it reads
+  // `*this` at another index (see `reads_shifted`).
+  template <typename E>
+  BasicVec& operator=(VecExpression<E> const& expr)
+  {
+    if (n != expr.size() || expr.reads_shifted(elems.get(), n))
+      return *this = BasicVec(expr);
+    assign(elems.get(), static_cast<E const&>(expr), n);
+    return *this;
+  }
+
+  double operator[](size_t i) const { return static_cast<double>(elems[i]); }
+
+  T& operator[](size_t i) { return elems[i]; }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    return Packet<W>::load(elems.get() + i);
+  }
+
+  size_t size() const { return n; }
+
+  template <typename U>
+  bool reads_shifted(U const* out, size_t len) const
+  {
+    return overlaps_shifted(elems.get(), n, out, len);
+  }
+
+  T* data() { return elems.get(); }
+  T const* data() const { return elems.get(); }
+
+  T* begin() { return elems.get(); }
+  T* end() { return elems.get() + n; }
+  T const* begin() const { return elems.get(); }
+  T const* end() const { return elems.get() + n; }
+};
+
+using Vec = BasicVec<double>;
+using VecF = BasicVec<float>;
+using VecBF16 = BasicVec<bfloat16>;
+
+// Operations are stateless types applied lane by lane, once on scalars (for
+// `operator[]`) and once on packets (for `packet<W>`). `Plus` is the only one
+// needed here, the rest of the algebra lives in et_ops.h.
+struct Plus
+{
+  static double apply(double a, double b) { return a + b; }
+
+  template <size_t W>
+  ET_INLINE static Packet<W> apply(Packet<W> const& a, Packet<W> const& b)
+  {
+    return a + b;
+  }
+};
+
+// The sum of tow `Vec`s is represented by a new type, `VecSum`, that is
+// templated on the types of the left- and right-hand sides of the sum os that
+// it can be applied to arbitrary pairs of `Vec` expressions. An overloaded
+// `operator+` serves as syntactic sugar for the `VecSum` constructor. A
+// subtlety intervenes in this case: in order to reference the original data
+// when summing two `VecExpression`s, `VecSum` needs to store a const reference
+// to each `VecExpression` if it is a leafs, otherwise it is a temporary object
+// that needs to be copied to be properly saved.
+//
+// `VecSum` is one instance of `VecBinary`, which is the same node with the
+// operation as an extra template parameter.
+template <typename Op, typename E1, typename E2>
+class VecBinary : public VecExpression<VecBinary<Op, E1, E2>>
+{
+  // cref if leaf, copy otherwise
+  typename std::conditional_t<E1::is_leaf, const E1&, const E1> _u;
+  typename std::conditional_t<E2::is_leaf, const E2&, const E2> _v;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  VecBinary(E1 const& u, E2 const& v) : _u(u), _v(v) { check_size(u, v); }
+
+  double operator[](size_t i) const { return Op::apply(_u[i], _v[i]); }
+
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    return Op::apply(_u.template packet<W>(i), _v.template packet<W>(i));
+  }
+
+  size_t size() const { return _v.size(); }
+
+  template <typename T>
+  bool reads_shifted(T const* out, size_t n) const
+  {
+    return _u.reads_shifted(out, n) || _v.reads_shifted(out, n);
+  }
+
+  E1 const& lhs() const { return _u; }
+  E2 const& rhs() const { return _v; }
+};
+
+template <typename E1, typename E2>
+using VecSum = VecBinary<Plus, E1, E2>;
+
+template <typename E1, typename E2>
+VecSum<E1, E2> operator+(VecExpression<E1> const& u, VecExpression<E2> const& v)
+{
+  return VecSum<E1, E2>(
+      *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)
+  );
+}
+
+/*
+With the above definitions, the expression `a + b + c` is of type
+
+VecSum<VecSum<Vec, Vec>, Vec>
+
+so `Vec x = a + b + c` invokes the templated `Vec` constructor
+`Vec(VecExpression<E> const& expr)` with its template argument `E` being this
+type (meaning `VecSum<VecSum<Vec, Vec>, Vec>`). Inside this constructor, the
+loop body
+
+out[i] = expr[i];
+
+is effectively expanded (following the recursive definitions of `operator+` and
+`operator[]` on this type) to
+
+out[i] = a.elems[i] + b.elems[i] + c.elems[i];
+
+with no temporary `Vec` objects needed and only one pass through each memory
+block. The kernel actually walks the vector with `packet<W>(i)`, which expands
+the same way over W lanes at once:
+
+load(a + i) + load(b + i) + load(c + i)  ->  store(out + i)
+*/
+
+} // namespace et
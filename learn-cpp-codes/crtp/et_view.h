@@ -0,0 +1,134 @@
+/**
+ * @file:	et_view.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 18:50:00 Saturday
+ * @brief:	non-owning strided view leaves over existing buffers
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "et_mat.h"
+#include "et_simd.h"
+#include "et_vec.h"
+
+namespace et
+{
+
+// A `VecView` reads `n` doubles at `p, p + stride, p + 2 * stride, ...` from
+// memory it does not own: a sub-range of a `Vec`, a column of a row-major
+// `Mat`, every other sample, a memory-mapped file. A pointer, a length and a
+// stride are as cheap to copy as a reference, so unlike a `Vec` it is not
+// tagged as a leaf and nodes store it by value: `slice`, `row`... return
+// temporaries, and `auto e = slice(v, 0, n) + a;` keeps its own copy. The
+// memory viewed must still outlive the expressions built on it. A negative
+// stride walks backwards.
+class VecView : public VecExpression<VecView>
+{
+  double const* _p = nullptr;
+  size_t _n = 0;
+  ptrdiff_t _stride = 1;
+
+public:
+  static constexpr bool is_leaf = false;
+
+  VecView() = default;
+
+  VecView(double const* p, size_t n, ptrdiff_t stride = 1)
+      : _p{p}, _n{n}, _stride{stride}
+  {
+  }
+
+  double operator[](size_t i) const
+  {
+    return _p[static_cast<ptrdiff_t>(i) * _stride];
+  }
+
+  // contiguous views load a packet at once, the others gather it lane by lane
+  template <size_t W>
+  ET_INLINE Packet<W> packet(size_t i) const
+  {
+    if (_stride == 1)
+      return Packet<W>::load(_p + i);
+    Packet<W> r;
+    for (size_t k = 0; k < W; ++k)
+      r.v[k] = _p[static_cast<ptrdiff_t>(i + k) * _stride];
+    return r;
+  }
+
+  size_t size() const { return _n; }
+
+  // Element `i` is read at `_p + i * stride` while `out + i` is written, so
+  // only a contiguous view starting at `out` itself is safe to overlap.
+  template <typename T>
+  bool reads_shifted(T const* out, size_t len) const
+  {
+    if (_n == 0 || len == 0)
+      return false;
+    if (_stride == 1)
+      return overlaps_shifted(_p, _n, out, len);
+
+    double const* last = _p + static_cast<ptrdiff_t>(_n - 1) * _stride;
+    auto a = reinterpret_cast<std::uintptr_t>(_stride > 0 ? _p : last);
+    auto b = reinterpret_cast<std::uintptr_t>(_stride > 0 ? last : _p);
+    auto o = reinterpret_cast<std::uintptr_t>(out);
+    return a < o + len * sizeof(T) && o < b + sizeof(double);
+  }
+
+  double const* data() const { return _p; }
+  ptrdiff_t stride() const { return _stride; }
+};
+
+// ================================================================================================
+// Factories
+// ================================================================================================
+
+inline VecView view(Vec const& v) { return VecView(v.data(), v.size()); }
+
+// `count` elements starting at `first`, `step` apart; `step` may be negative
+inline VecView
+slice(VecView const& v, size_t first, size_t count, ptrdiff_t step = 1)
+{
+  if (count == 0)
+    return VecView(v.data(), 0, v.stride());
+  auto const last =
+      static_cast<ptrdiff_t>(first) + static_cast<ptrdiff_t>(count - 1) * step;
+  if (first >= v.size() || last < 0 || static_cast<size_t>(last) >= v.size())
+    throw std::out_of_range("slice out of range");
+  return VecView(
+      v.data() + static_cast<ptrdiff_t>(first) * v.stride(), count,
+      step * v.stride()
+  );
+}
+
+inline VecView
+slice(Vec const& v, size_t first, size_t count, ptrdiff_t step = 1)
+{
+  return slice(view(v), first, count, step);
+}
+
+inline VecView reversed(Vec const& v)
+{
+  return v.size() ? slice(v, v.size() - 1, v.size(), -1) : view(v);
+}
+
+// row `r` of a row-major matrix, contiguous
+inline VecView row(Mat const& m, size_t r)
+{
+  if (r >= m.rows())
+    throw std::out_of_range("row out of range");
+  return VecView(m.data() + r * m.cols(), m.cols());
+}
+
+// column `c` of a row-major matrix, strided by the row length
+inline VecView column(Mat const& m, size_t c)
+{
+  if (c >= m.cols())
+    throw std::out_of_range("column out of range");
+  return VecView(m.data() + c, m.rows(), static_cast<ptrdiff_t>(m.cols()));
+}
+
+} // namespace et
@@ -5,146 +5,733 @@
  * @brief:	https://en.wikipedia.org/wiki/Expression_templates
  **/
 
-#include <array>
-#include <cassert>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <type_traits>
+#include <vector>
 
-// A base class `VecExpression` represents any vector-valued expression. It is
-// templated on the actual expression type `E` to be implemented, per the
-// _curiously recurring template pattern_. The existence of a base class like
-// `VecExpression` is not strictly necessary for expression templates to work.
-// It will merely serve as a function argument type to distinguish the
-// expressions from other types (note the definition of a `Vec` constructor and
-// `operator+` below).
+#include "et_eval.h"
+#include "et_mat.h"
+#include "et_math.h"
+#include "et_ops.h"
+#include "et_reduce.h"
+#include "et_rewrite.h"
+#include "et_scan.h"
+#include "et_select.h"
+#include "et_sparse.h"
+#include "et_view.h"
+#include "et_vec.h"
 
-template <typename E>
-class VecExpression
+using namespace et;
+
+// `assert` that stays on in release builds: the tests are what this file is
+// for, and they run optimized too
+#define CHECK(cond) ((cond) ? void(0) : check_failed(#cond, __FILE__, __LINE__))
+
+[[noreturn]] void check_failed(char const* cond, char const* file, int line)
+{
+  std::cerr << file << ':' << line << ": check failed: " << cond << std::endl;
+  std::abort();
+}
+
+void test1()
+{
+  Vec v0 = {23.4, 12.5, 144.56};
+  Vec v1 = {67.12, 34.8, 90.34};
+  Vec v2 = {34.90, 111.9, 45.12};
+
+  // Following assignment will call the ctor of Vec which accept type of
+  // `VecExpression<E> const&`. Then expand the loop body to a.elems[i] +
+  // b.elems[i] + c.elems[i]
+  Vec sum_of_vec_type = v0 + v1 + v2;
+
+  for (size_t i = 0; i < sum_of_vec_type.size(); ++i)
+    std::cout << sum_of_vec_type[i] << std::endl;
+
+  // To avoid creating any extra storage, other than v0, v1, v2, one can do the
+  // following (Tested with C++11 on GCC 5.3.0)
+  auto sum = v0 + v1 + v2;
+  for (size_t i = 0; i < sum.size(); ++i)
+    std::cout << sum[i] << std::endl;
+}
+
+// runtime-sized leaves: a single fused pass over large aligned buffers
+void test2()
 {
-public:
-  static constexpr bool is_leaf = false;
+  const size_t n = 1 << 20;
+  Vec a(n, 1.0), b(n, 2.0), c(n, 3.0);
 
-  double operator[](size_t i) const
+  Vec x = a + b + c;
+  CHECK(x.size() == n);
+  CHECK(reinterpret_cast<std::uintptr_t>(x.data()) % vec_alignment == 0);
+  CHECK(x[0] == 6.0 && x[n - 1] == 6.0);
+
+  // same size, the buffer of `x` is reused
+  x = x + a;
+  CHECK(x[n / 2] == 7.0);
+
+  try
+  {
+    Vec y = a + Vec(n - 1);
+  }
+  catch (std::length_error& e)
   {
-    // Delegation to the actual expression type. This avoids dynamic
-    // polymorphism (a.k.a. virtual functions in C++)
-    return static_cast<E const&>(*this)[i];
+    std::cout << e.what() << std::endl;
   }
+}
 
-  size_t size() const { return static_cast<E const&>(*this).size(); }
-};
+// packet evaluation: every ISA the CPU supports gives the same result
+void test3()
+{
+  std::cout << "detected isa: " << isa_name(detect_isa()) << std::endl;
 
-// The boolean `is_leaf` is there to tag `VecExpression`s that are '"leafs",
-// i.e. that actually contain data. The `Vec` class is a leaf that stores the
-// coordinates of a fully evaluated vector expression, and becomes a subclass of
-// `VecExpression`.
+  // odd length to exercise the scalar tail
+  const size_t n = 1003;
+  Vec a(n), b(n), c(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    a[i] = 0.5 * i;
+    b[i] = 1.0 / (i + 1);
+    c[i] = 3.0;
+  }
+
+  for (Isa isa : {Isa::sse2, Isa::avx2, Isa::avx512})
+  {
+    set_isa(isa);
+    Vec x = a + b + c;
+    for (size_t i = 0; i < n; ++i)
+      CHECK(x[i] == a[i] + b[i] + c[i]);
+    std::cout << "checked with " << isa_name(active_isa()) << std::endl;
+  }
+  set_isa(detect_isa());
+}
 
-class Vec : public VecExpression<Vec>
+// the rest of the algebra, each formula is still a single fused pass
+void test4()
 {
-  std::array<double, 3> elems;
+  const size_t n = 1001;
+  Vec x(n), y(n), d(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    x[i] = 0.25 * i - 100.0;
+    y[i] = 3.0 - 0.5 * i;
+    d[i] = 1.0 + i;
+  }
 
-public:
-  static constexpr bool is_leaf = true;
+  // VecBinary<Plus, VecBinary<Minus, ...>, VecBinary<Divides, VecConst, Vec>>
+  Vec r = 2.0 * x + y - x / d - 1.0;
+  Vec h = sqrt(x * x + y * y);
+  Vec m = -abs(x) + exp(log(d));
 
-  decltype(auto) operator[](size_t i) const { return elems[i]; }
+  for (size_t i = 0; i < n; ++i)
+  {
+    CHECK(std::fabs(r[i] - (2.0 * x[i] + y[i] - x[i] / d[i] - 1.0)) < 1e-12);
+    CHECK(std::fabs(h[i] - std::hypot(x[i], y[i])) < 1e-9);
+    CHECK(std::fabs(m[i] - (d[i] - std::fabs(x[i]))) < 1e-9);
+  }
+}
 
-  // decltype(auto)& operator[](size_t i) { return elems[i]; }
+// reductions consume the expression directly, no `Vec` is materialized
+void test5()
+{
+  const size_t n = 10007;
+  Vec a(n), b(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    a[i] = std::sin(0.01 * i);
+    b[i] = std::cos(0.03 * i);
+  }
+  a[4242] = 7.0;
 
-  size_t size() const { return elems.size(); }
+  double s = 0, d = 0, q = 0, lo = a[0] + b[0], hi = lo;
+  size_t at = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    double x = a[i] + b[i];
+    s += x;
+    d += a[i] * b[i];
+    q += x * x;
+    lo = std::min(lo, x);
+    if (x > hi)
+      hi = x, at = i;
+  }
 
-  // construct Vec using initializer list
-  Vec(std::initializer_list<double> init)
+  for (Isa isa : {Isa::sse2, Isa::avx2, Isa::avx512})
   {
-    std::copy(init.begin(), init.end(), elems.begin());
+    set_isa(isa);
+    CHECK(std::fabs(sum(a + b) - s) < 1e-9);
+    CHECK(std::fabs(dot(a, b) - d) < 1e-9);
+    CHECK(std::fabs(norm2(a + b) - std::sqrt(q)) < 1e-9);
+    CHECK(min(a + b) == lo);
+    CHECK(max(a + b) == hi);
+    CHECK(argmax(a + b) == at);
   }
+  set_isa(detect_isa());
 
-  // A Vec can be constructed from any VecExpression, forcing its evaluation.
-  template <typename E>
-  Vec(VecExpression<E> const& expr)
+  std::cout << "sum: " << sum(a + b) << ", dot: " << dot(a, b)
+            << ", argmax: " << argmax(a + b) << std::endl;
+}
+
+// opt-in chunked evaluation over a thread pool
+void test6()
+{
+  const size_t n = (1 << 20) + 13;
+  Vec a(n), b(n, 0.5);
+  for (size_t i = 0; i < n; ++i)
+    a[i] = double(i);
+
+  set_threads(4);
+  set_parallel_threshold(1 << 16);
+
+  Vec x = 2.0 * a + b;
+  x = x - a; // aliasing `x` is fine, chunks are disjoint
+  for (size_t i = 0; i < n; ++i)
+    CHECK(x[i] == a[i] + 0.5);
+
+  // below the threshold the calling thread does the work
+  Vec small = Vec(100, 1.0) + Vec(100, 2.0);
+  CHECK(small[99] == 3.0);
+
+  // a parallel evaluation started from a chunk runs on that chunk's thread
+  std::vector<Vec> parts(8);
+  parallel_policy().pool->run(parts.size(), [&](size_t c) {
+    parts[c] = Vec(a + b * double(c));
+  });
+  for (size_t c = 0; c < parts.size(); ++c)
+    CHECK(parts[c][n - 1] == a[n - 1] + 0.5 * double(c));
+
+  // a chunk that throws, on whichever thread: the caller gets the exception
+  // once the job is over, and the pool takes the next job
+  for (size_t thrower : {size_t{0}, size_t{31}})
   {
-    for (size_t i = 0; i != expr.size(); ++i)
+    std::atomic<size_t> done{0};
+    try
     {
-      elems[i] = expr[i];
+      parallel_policy().pool->run(32, [&](size_t c) {
+        if (c == thrower)
+          throw std::runtime_error("chunk");
+        ++done;
+      });
+      CHECK(false);
     }
+    catch (std::runtime_error const&)
+    {
+    }
+    CHECK(done < 32);
   }
-};
+  x = 2.0 * a + b;
+  CHECK(x[n - 1] == 2.0 * a[n - 1] + 0.5);
+
+  std::cout << "evaluated on " << threads() << " threads" << std::endl;
+  set_threads(1);
+}
 
-// The sum of tow `Vec`s is represented by a new type, `VecSum`, that is
-// templated on the types of the left- and right-hand sides of the sum os that
-// it can be applied to arbitrary pairs of `Vec` expressions. An overloaded
-// `operator+` serves as syntactic sugar for the `VecSum` constructor. A
-// subtlety intervenes in this case: in order to reference the original data
-// when summing two `VecExpression`s, `VecSum` needs to store a const reference
-// to each `VecExpression` if it is a leafs, otherwise it is a temporary object
-// that needs to be copied to be properly saved.
-template <typename E1, typename E2>
-class VecSum : public VecExpression<VecSum<E1, E2>>
+// in-place updates evaluate straight into the destination
+void test7()
 {
-  // cref if leaf, copy otherwise
-  typename std::conditional_t<E1::is_leaf, const E1&, const E1> _u;
-  typename std::conditional_t<E2::is_leaf, const E2&, const E2> _v;
+  const size_t n = 1000;
+  Vec v(n, 1.0), w(n);
+  for (size_t i = 0; i < n; ++i)
+    w[i] = double(i);
+
+  double const* storage = v.data();
+  v += 2.0 * w;  // v = 1 + 2i
+  v -= w;        // v = 1 + i
+  v *= v;        // reads v[i] while writing v[i], no temporary needed
+  v /= 2.0;
+  CHECK(v.data() == storage);
 
-public:
-  static constexpr bool is_leaf = false;
+  for (size_t i = 0; i < n; ++i)
+    CHECK(v[i] == (1.0 + i) * (1.0 + i) / 2.0);
 
-  VecSum(E1 const& u, E2 const& v) : _u(u), _v(v)
+  try
+  {
+    v += Vec(n + 1);
+  }
+  catch (std::length_error& e)
   {
-    assert(u.size() == v.size());
+    std::cout << e.what() << std::endl;
   }
+}
+
+// compile-time rewriting: fma fusion, identities, balanced sums
+void test8()
+{
+  const size_t n = 1003;
+  Vec a(n), b(n), c(n), d(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    a[i] = 0.5 * i;
+    b[i] = 3.0 - i;
+    c[i] = 1.0 / (1 + i);
+    d[i] = 2.0;
+  }
+
+  // VecSum<VecFma<Vec, Vec, Vec>, VecSum<Vec, Vec>>
+  auto e = optimize(a * b + c + d * ones(n) + zeros(n) + a);
+  static_assert(std::is_same_v<
+                decltype(e),
+                VecSum<VecFma<Vec, Vec, Vec>, VecSum<Vec, Vec>>>);
+
+  // identities vanish, leaves are still referenced and not copied
+  decltype(auto) same = optimize(a * ones(n) - zeros(n));
+  CHECK(&same == &a);
 
-  decltype(auto) operator[](size_t i) const { return _u[i] + _v[i]; }
-  size_t size() const { return _v.size(); }
-};
+  for (Isa isa : {Isa::sse2, Isa::avx2, Isa::avx512})
+  {
+    set_isa(isa);
+    Vec x = e;
+    for (size_t i = 0; i < n; ++i)
+      CHECK(std::fabs(x[i] - (a[i] * b[i] + c[i] + d[i] + a[i])) < 1e-9);
+  }
+  set_isa(detect_isa());
+}
 
-template <typename E1, typename E2>
-VecSum<E1, E2> operator+(VecExpression<E1> const& u, VecExpression<E2> const& v)
+// matrices: fused elementwise nodes, blocked product
+void test9()
 {
-  return VecSum<E1, E2>(
-      *static_cast<const E1*>(&u), *static_cast<const E2*>(&v)
-  );
+  Mat x = {{1, 2}, {3, 4}};
+  Mat y = (x + x) * x - 2.0 * x; // operand `x + x` is fused into packing
+  CHECK(y(0, 0) == 12 && y(0, 1) == 16 && y(1, 0) == 24 && y(1, 1) == 36);
+
+  // odd shapes to exercise the edge tiles of the micro-kernel
+  const size_t m = 67, k = 300, n = 45;
+  Mat a(m, k), b(k, n);
+  for (size_t i = 0; i < m; ++i)
+    for (size_t p = 0; p < k; ++p)
+      a(i, p) = std::sin(0.1 * i + p);
+  for (size_t p = 0; p < k; ++p)
+    for (size_t j = 0; j < n; ++j)
+      b(p, j) = std::cos(0.2 * p - j);
+
+  for (Isa isa : {Isa::sse2, Isa::avx2, Isa::avx512})
+  {
+    set_isa(isa);
+    Mat c = a * b;
+    for (size_t i = 0; i < m; ++i)
+      for (size_t j = 0; j < n; ++j)
+      {
+        double s = 0;
+        for (size_t p = 0; p < k; ++p)
+          s += a(i, p) * b(p, j);
+        CHECK(std::fabs(c(i, j) - s) < 1e-9);
+      }
+  }
+  set_isa(detect_isa());
+
+  try
+  {
+    Mat bad = a * a;
+  }
+  catch (std::length_error& e)
+  {
+    std::cout << e.what() << std::endl;
+  }
 }
 
-/*
-With the above definitions, the expression `a + b + c` is of type
+// views: expressions over existing buffers, without staging copies
+void test10()
+{
+  // a plain buffer, e.g. memory-mapped samples
+  double raw[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  VecView even(raw, 5, 2), odd(raw + 1, 5, 2);
+  Vec diff = odd - even;
+  CHECK(sum(diff) == 5.0);
 
-VecSum<VecSum<Vec, Vec>, Vec>
+  Mat m(100, 3);
+  for (size_t r = 0; r < m.rows(); ++r)
+    for (size_t c = 0; c < m.cols(); ++c)
+      m(r, c) = r * 10.0 + c;
+  Vec col = column(m, 2) - column(m, 0);
+  CHECK(min(col) == 2.0 && max(col) == 2.0);
+  CHECK(dot(row(m, 1), row(m, 2)) == 10 * 20 + 11 * 21 + 12 * 22);
 
-so `Vec x = a + b + c` invokes the templated `Vec` constructor
-`Vec(VecExpression<E> const& expr)` with its template argument `E` being this
-type (meaning `VecSum<VecSum<Vec, Vec>, Vec>`). Inside this constructor, the
-loop body
+  Vec v(1003);
+  for (size_t i = 0; i < v.size(); ++i)
+    v[i] = double(i);
+  Vec tail = slice(v, 3, 1000) + slice(v, 1002, 1000, -1);
+  for (size_t i = 0; i < tail.size(); ++i)
+    CHECK(tail[i] == 1005.0);
 
-elems[i] = expr[i];
+  // views are held by value: an expression over temporary views can be kept
+  // and evaluated statements later
+  auto stored = slice(v, 3, 1000) + slice(v, 1002, 1000, -1);
+  auto halved = stored * 0.5;
+  Vec again = halved - view(tail);
+  for (size_t i = 0; i < again.size(); ++i)
+    CHECK(again[i] == -502.5);
 
-is effectively expanded (following the recursive definitions of `operator+` and
-`operator[]` on this type) to
+  // `v` reads itself backwards: evaluated through a temporary
+  v = reversed(v);
+  v += slice(v, 0, v.size()); // same element, no temporary needed
+  for (size_t i = 0; i < v.size(); ++i)
+    CHECK(v[i] == 2.0 * (1002 - i));
+}
 
-elems[i] = a.elems[i] + b.elems[i] + c.elems[i];
+// mixed precision: narrow storage, double arithmetic
+void test11()
+{
+  const size_t n = 4099;
+  VecF f(n);
+  VecBF16 h(n);
+  Vec d(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    f[i] = 1.0f / (1 + i);
+    h[i] = bfloat16(0.5f * i);
+    d[i] = 1.0 / 3.0;
+  }
 
-with no temporary `Vec` objects needed and only one pass through each memory
-block.
-*/
+  // float + bfloat16 + double, computed in double, stored as float
+  VecF r = f + h + d;
+  for (size_t i = 0; i < n; ++i)
+    CHECK(r[i] == float(double(f[i]) + double(float(h[i])) + d[i]));
 
-int main(int argc, char** argv)
+  // accumulation is in double: 2^24 + 1.0f steps would stall in float
+  VecF ones_f(1 << 25, 1.0f);
+  CHECK(sum(ones_f) == double(1 << 25));
+
+  // bfloat16 keeps 8 bits of mantissa, rounding to nearest even
+  CHECK(float(bfloat16(1.0f + 1.0f / 256)) == 1.0f);
+  CHECK(float(bfloat16(1.0f + 3.0f / 256)) == 1.0f + 4.0f / 256);
+  CHECK(float(bfloat16(-2.5f)) == -2.5f);
+}
+
+// sparse leaves: only nonzeros are visited
+void test12()
 {
-  Vec v0 = {23.4, 12.5, 144.56};
-  Vec v1 = {67.12, 34.8, 90.34};
-  Vec v2 = {34.90, 111.9, 45.12};
+  const size_t n = 100000;
+  SparseVec s(n), t(n);
+  Vec x(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    x[i] = 0.5 * i;
+    if (i % 20 == 3)
+      s.push_back(i, 1.0 + i);
+    if (i % 30 == 3)
+      t.push_back(i, -2.0);
+  }
+  Vec sd = s, td = t; // dense copies
+  CHECK(sd[3] == 4.0 && sd[4] == 0.0 && sum(sd) == sum(s));
 
-  // Following assignment will call the ctor of Vec which accept type of
-  // `VecExpression<E> const&`. Then expand the loop body to a.elems[i] +
-  // b.elems[i] + c.elems[i]
-  Vec sum_of_vec_type = v0 + v1 + v2;
+  // `dense + alpha * sparse` copies runs of `x` and adds at the nonzeros
+  Vec y = x + 2.0 * s;
+  Vec y_dense = x + 2.0 * sd;
+  for (size_t i = 0; i < n; ++i)
+    CHECK(y[i] == y_dense[i]);
 
-  for (int i = 0; i < sum_of_vec_type.size(); ++i)
-    std::cout << sum_of_vec_type[i] << std::endl;
+  // in place, O(nnz)
+  y -= 2.0 * s;
+  for (size_t i = 0; i < n; ++i)
+    CHECK(y[i] == x[i]);
 
-  // To avoid creating any extra storage, other than v0, v1, v2, one can do the
-  // following (Tested with C++11 on GCC 5.3.0)
-  auto sum = v0 + v1 + v2;
-  for (int i = 0; i < sum.size(); ++i)
-    std::cout << sum[i] << std::endl;
+  // sparse dots: gather from `x` / merge index lists
+  CHECK(dot(x, s) == dot(x, sd));
+  CHECK(dot(s, t) == dot(sd, td));
+  CHECK(std::abs(norm2(s) - norm2(sd)) < 1e-9 * norm2(sd));
+
+  // sparse-only expressions stay sparse: union for +, intersection for *
+  SparseVec u = s + 3.0 * t;
+  SparseVec w = s * t;
+  SparseVec z = s - s; // cancels, nothing stored
+  CHECK(u.nnz() == s.nnz() + t.nnz() - n / 60 - (n % 60 > 3));
+  CHECK(w.nnz() == n / 60 + (n % 60 > 3) && w[63] == -2.0 * 64);
+  CHECK(z.nnz() == 0 && z.size() == n);
+  Vec ud = u;
+  Vec ud_dense = sd + 3.0 * td;
+  for (size_t i = 0; i < n; ++i)
+    CHECK(ud[i] == ud_dense[i]);
+
+  // a sparse leaf in a dense tree reads its zeros too
+  Vec m = (x - s) * 0.5 + abs(t);
+  for (size_t i = 0; i < n; ++i)
+    CHECK(m[i] == (x[i] - sd[i]) * 0.5 + std::abs(td[i]));
+
+  // narrow storage, still nonzeros only
+  VecF f(n, 1.0f);
+  f += s;
+  CHECK(f[23] == 25.0f && f[24] == 1.0f);
+
+  std::cout << "sparse: " << s.nnz() << " + " << t.nnz() << " -> " << u.nnz()
+            << " nonzeros of " << n << std::endl;
+}
+
+// eval: a shared subexpression computed once, into reused scratch memory
+void test13()
+{
+  const size_t n = 100000;
+  Vec a(n), b(n), c(n, 2.0), y(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    a[i] = 0.25 * i;
+    b[i] = 1.0 + i;
+  }
+
+  size_t warm = 0;
+  for (int iter = 0; iter < 100; ++iter)
+  {
+    // the first iteration grows the arena to its peak, the others reuse it
+    if (iter == 1)
+      warm = scratch_arena().allocations();
+    auto ab = eval(a + b);
+    y = ab * ab + c / ab + sqrt(eval(ab * 0.5));
+  }
+  CHECK(scratch_arena().allocations() == warm);
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    double ab = a[i] + b[i];
+    CHECK(y[i] == ab * ab + c[i] / ab + std::sqrt(ab * 0.5));
+  }
+
+  // hoisted: evaluations in a loop under a live one reuse the same bytes
+  {
+    auto ab = eval(a + b);
+    size_t footprint = 0;
+    for (int iter = 0; iter < 100; ++iter)
+    {
+      auto half = eval(ab * 0.5);
+      y = half + eval(half * half);
+      if (iter == 0)
+      {
+        warm = scratch_arena().allocations();
+        footprint = scratch_arena().capacity();
+      }
+    }
+    CHECK(scratch_arena().allocations() == warm);
+    CHECK(scratch_arena().capacity() == footprint);
+    CHECK(scratch_arena().live() == 1);
+    double h = 0.5 * (a[7] + b[7]);
+    CHECK(y[7] == h + h * h);
+  }
+  CHECK(scratch_arena().live() == 0);
+
+  // memory the arena did not hand out is refused, the arena is unchanged
+  double* mine = scratch_arena().allocate<double>(4);
+  try
+  {
+    scratch_arena().release(a.data());
+    CHECK(false);
+  }
+  catch (std::logic_error const&)
+  {
+  }
+  CHECK(scratch_arena().live() == 1);
+  scratch_arena().release(mine);
+  CHECK(scratch_arena().live() == 0);
+
+  std::cout << "scratch arena: " << scratch_arena().capacity() << " bytes in "
+            << scratch_arena().allocations() << " allocation(s)" << std::endl;
+}
+
+// masks and select: conditionals without branches
+void test14()
+{
+  const size_t n = 10007;
+  Vec a(n), b(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    a[i] = std::sin(0.37 * i) * 10.0;
+    b[i] = std::cos(0.11 * i) * 10.0;
+  }
+
+  // clamp to [-5, 5] and a piecewise function
+  Vec clamped = select(a < -5.0, -5.0, select(a > 5.0, 5.0, a));
+  Vec piecewise = select(a >= 0.0, sqrt(abs(a)), b * b);
+  Vec both = (a > 0.0) && !(b > 0.0);
+
+  size_t positive = 0, inside = 0;
+  double inside_sum = 0.0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    CHECK(clamped[i] == std::min(5.0, std::max(-5.0, a[i])));
+    CHECK(piecewise[i] == (a[i] >= 0.0 ? std::sqrt(a[i]) : b[i] * b[i]));
+    CHECK(both[i] == ((a[i] > 0.0 && b[i] <= 0.0) ? 1.0 : 0.0));
+    positive += a[i] > 0.0;
+    if (a[i] < b[i] || a[i] == 0.0)
+    {
+      ++inside;
+      inside_sum += a[i];
+    }
+  }
+
+  CHECK(count_if(a > 0.0) == positive);
+  CHECK(count_if(a < b || a == 0.0) == inside);
+  CHECK(std::abs(sum_if(a < b || a == 0.0, a) - inside_sum) < 1e-9 * n);
+
+  // what is outside the mask is never picked, even a NaN
+  Vec c = log(a); // NaN where a < 0
+  CHECK(!std::isnan(sum_if(a > 0.0, c)));
+  CHECK(std::isnan(sum(c)));
+}
+
+// prefix scans, fused with their input, sequential and in blocks
+void test15()
+{
+  const size_t n = 300007;
+  Vec a(n), b(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    a[i] = double(i % 7);
+    b[i] = double(i % 3) - 1.0;
+  }
+
+  // small integers: every partial sum is exact, whatever the association
+  Vec expected(n), expected_max(n);
+  double acc = 0.0, top = -1e300;
+  for (size_t i = 0; i < n; ++i)
+  {
+    acc += a[i] * b[i] + 1.0;
+    top = std::max(top, a[i] - b[i]);
+    expected[i] = acc;
+    expected_max[i] = top;
+  }
+
+  for (size_t t : {1, 4})
+  {
+    set_threads(t);
+    set_parallel_threshold(1 << 16);
+    for (Isa isa : {Isa::sse2, Isa::avx2, Isa::avx512})
+    {
+      set_isa(isa);
+      Vec inc = inclusive_scan(a * b + 1.0);
+      Vec exc = exclusive_scan(a * b + 1.0, 10.0);
+      Vec run_max = inclusive_scan<MaxReducer>(a - b);
+      for (size_t i = 0; i < n; ++i)
+      {
+        CHECK(inc[i] == expected[i]);
+        CHECK(exc[i] == 10.0 + (i ? expected[i - 1] : 0.0));
+        CHECK(run_max[i] == expected_max[i]);
+      }
+    }
+    set_isa(detect_isa());
+  }
+  set_threads(1);
+
+  // in place, into float storage, and a running product
+  Vec c = a;
+  inclusive_scan(c, c);
+  CHECK(c[n - 1] == sum(a));
+  VecF f(3);
+  inclusive_scan(Vec{0.5, 0.25, 2.0}, f);
+  CHECK(f[0] == 0.5f && f[1] == 0.75f && f[2] == 2.75f);
+  Vec p = inclusive_scan<ProductReducer>(Vec{1.0, 2.0, 3.0, 4.0, 5.0});
+  CHECK(p[4] == 120.0 && prod(Vec{1.0, 2.0, 3.0, 4.0, 5.0}) == 120.0);
+}
+
+// transcendental functions: exp, log, sin, cos, tanh across every ISA
+void test16()
+{
+  // relative distance, in units of double epsilon
+  auto close = [](double got, double want, double eps) {
+    return std::fabs(got - want) <= eps * 0x1p-52 * std::fabs(want);
+  };
+
+  const size_t n = 1003;
+  Vec x(n), pos(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    x[i] = -700.0 + 1400.0 * double(i) / double(n - 1);
+    pos[i] = std::ldexp(1.0 + double(i) / double(n), int(i % 2000) - 1000);
+  }
+
+  for (Isa isa : {Isa::sse2, Isa::avx2, Isa::avx512})
+  {
+    set_isa(isa);
+    Vec e = exp(x), l = log(pos), s = sin(x), c = cos(x), t = tanh(x * 0.01);
+    for (size_t i = 0; i < n; ++i)
+    {
+      CHECK(close(e[i], std::exp(x[i]), 2));
+      CHECK(close(l[i], std::log(pos[i]), 2));
+      // absolute near the zeros of sin and cos
+      CHECK(std::fabs(s[i] - std::sin(x[i])) <= 4 * 0x1p-52);
+      CHECK(std::fabs(c[i] - std::cos(x[i])) <= 4 * 0x1p-52);
+      CHECK(close(t[i], std::tanh(x[i] * 0.01), 3));
+    }
+  }
+  set_isa(detect_isa());
+
+  // Next to multiples of pi/2, the reduction of sin and cos cancels down to
+  // a tiny z, so these are checked in ulp against a long double reference:
+  // the doubles nearest to k pi/2 and their neighbours, k spread over the
+  // whole of [1, trig_max / (pi/2)], and a few known hard cases.
+  long double const half_pi = 1.57079632679489661923132169163975144L;
+  auto ulps = [](double got, long double want) {
+    double w = std::fabs(static_cast<double>(want));
+    double ulp = std::nextafter(w, HUGE_VAL) - w;
+    return static_cast<double>(std::fabs(got - want) / ulp);
+  };
+
+  std::vector<double> hard{
+      21.991148575128552, 91.106186954104004, 183107.7278144811,
+      96098045.733766735, 35099077.926687822
+  };
+  for (long double k = 1; k * half_pi < math::trig_max; k = std::floor(k * 1.1L) + 1)
+  {
+    double x = static_cast<double>(k * half_pi);
+    hard.insert(
+        hard.end(), {std::nextafter(x, 0.0), x, std::nextafter(x, HUGE_VAL), -x}
+    );
+  }
+  Vec near(hard.size());
+  for (size_t i = 0; i < near.size(); ++i)
+    near[i] = hard[i];
+
+  for (Isa isa : {Isa::sse2, Isa::avx2, Isa::avx512})
+  {
+    set_isa(isa);
+    Vec s = sin(near), c = cos(near);
+    for (size_t i = 0; i < near.size(); ++i)
+    {
+      long double xl = near[i];
+      CHECK(ulps(s[i], std::sin(xl)) <= 2.0);
+      CHECK(ulps(c[i], std::cos(xl)) <= 2.0);
+    }
+  }
+  set_isa(detect_isa());
+
+  // special values, through the array API and the packet path alike
+  double const inf = std::numeric_limits<double>::infinity();
+  double const nan = std::numeric_limits<double>::quiet_NaN();
+  Vec special{-inf, inf, nan, 0.0, -1.0, 0x1p-1074, 1e300, -800.0};
+  Vec y(special.size());
+  math::exp(special.data(), y.data(), special.size());
+  CHECK(y[0] == 0.0 && y[1] == inf && std::isnan(y[2]) && y[3] == 1.0);
+  CHECK(y[6] == inf && y[7] == 0.0);
+  y = log(special);
+  CHECK(std::isnan(y[0]) && y[1] == inf && std::isnan(y[2]));
+  CHECK(y[3] == -inf && std::isnan(y[4]) && close(y[5], std::log(0x1p-1074), 1));
+  y = sin(special);
+  CHECK(std::isnan(y[0]) && std::isnan(y[1]) && y[3] == 0.0);
+  CHECK(y[6] == std::sin(1e300)); // beyond trig_max: libm
+  y = tanh(special);
+  CHECK(y[0] == -1.0 && y[1] == 1.0 && std::isnan(y[2]) && y[7] == -1.0);
+}
+
+int main()
+{
+  test1();
+  test2();
+  test3();
+  test4();
+  test5();
+  test6();
+  test7();
+  test8();
+  test9();
+  test10();
+  test11();
+  test12();
+  test13();
+  test14();
+  test15();
+  test16();
 
   return 0;
 }
@@ -0,0 +1,144 @@
+/**
+ * @file:	limit_bench.cpp
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 23:40:00 Saturday
+ * @brief:	construction throughput of limited types under thread contention
+ **/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bench/bench.h"
+#include "limit_instances.h"
+
+// Every thread creates and destroys objects of one limited type in a loop,
+// keeping a few of them alive, and the total rate is reported against the
+// number of threads:
+//
+// - shared:  one atomic counter, the scheme of `LimitNoOfInstances`
+// - sharded: `ShardedLimitNoOfInstances` of limit_instances.h
+//
+// With the shared counter, the rate stays flat or drops as threads are added,
+// the counter line bouncing between cores; the sharded one should grow with
+// the number of cores.
+
+constexpr uint32_t limit = 1 << 20;
+
+// `LimitNoOfInstances` with its check and increment folded into one
+// `fetch_add`: the same single line written by every construction
+template <typename ToBeLimited, uint32_t maxInstance>
+struct SharedLimitNoOfInstances
+{
+  static inline std::atomic<uint32_t> cnt{0};
+
+  SharedLimitNoOfInstances()
+  {
+    if (cnt.fetch_add(1) >= maxInstance)
+    {
+      --cnt;
+      throw std::logic_error("Too many instances");
+    }
+  }
+
+  ~SharedLimitNoOfInstances() { --cnt; }
+};
+
+struct Shared : SharedLimitNoOfInstances<Shared, limit>
+{
+  uint64_t payload = 0;
+};
+
+struct Sharded : ShardedLimitNoOfInstances<Sharded, limit>
+{
+  uint64_t payload = 0;
+};
+
+// median of `reps` runs, in seconds
+template <typename F>
+double median_of(int reps, F&& f)
+{
+  bench::Options opt;
+  opt.warmup = 0.0;
+  opt.min_sample = 0.0; // one run per sample
+  opt.samples = static_cast<size_t>(reps);
+  return bench::measure(f, opt).median;
+}
+
+// `per_thread` objects from each of `threads` threads, started together
+template <typename T>
+void run(size_t threads, size_t per_thread)
+{
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> pool;
+
+  for (size_t t = 0; t < threads; ++t)
+    pool.emplace_back([&] {
+      std::optional<T> alive[8];
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+      for (size_t i = 0; i < per_thread; ++i)
+      {
+        auto& slot = alive[i % 8];
+        slot.reset();
+        slot.emplace();
+      }
+    });
+
+  while (ready.load() != threads)
+    std::this_thread::yield();
+  go.store(true, std::memory_order_release);
+  for (auto& t : pool)
+    t.join();
+}
+
+// objects per second, all threads together; the time includes starting the
+// threads, small next to the millions of objects they create
+template <typename T>
+double rate(size_t threads, size_t per_thread, int reps)
+{
+  double const seconds =
+      median_of(reps, [&] { run<T>(threads, per_thread); });
+  return static_cast<double>(threads * per_thread) / seconds;
+}
+
+// usage: crtp_limit_bench [max threads] [objects per thread]
+int main(int argc, char** argv)
+{
+  size_t const hw = std::max(1u, std::thread::hardware_concurrency());
+  size_t const max_threads =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::max<size_t>(hw, 8);
+  size_t const per_thread =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+  int const reps = 5;
+
+  std::cout << hw << " hardware thread(s), " << per_thread
+            << " objects per thread, Mobjects/s (median of " << reps
+            << ")\n"
+            << std::setw(8) << "threads" << std::setw(10) << "shared"
+            << std::setw(10) << "sharded" << std::setw(9) << "ratio\n"
+            << std::fixed << std::setprecision(1);
+
+  for (size_t t = 1; t <= max_threads; t *= 2)
+  {
+    double shared = rate<Shared>(t, per_thread, reps);
+    double sharded = rate<Sharded>(t, per_thread, reps);
+    std::cout << std::setw(8) << t << std::setw(10) << shared * 1e-6
+              << std::setw(10) << sharded * 1e-6 << std::setw(8)
+              << sharded / shared << "x\n";
+  }
+
+  if (Sharded::cnt.live() != 0 || Shared::cnt != 0)
+    throw std::logic_error("instances leaked");
+  return 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file:	limit_instances.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/17 23:20:00 Saturday
+ * @brief:	instance limit without a shared counter write per object
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+
+// `LimitNoOfInstances` (main.cpp) does `++cnt` / `--cnt` on one atomic for
+// every object: with several threads creating objects, the cache line of
+// `cnt` moves from core to core on every construction.
+//
+// `ShardedCount<limit>` splits the free capacity, `limit - live`, between a
+// global pool and one budget per shard, each shard on its own cache line. A
+// thread always uses the same shard: taking a unit from its budget or giving
+// one back touches that line only. An empty budget takes a batch from the
+// pool, a budget grown past two batches gives one back, so the pool is only
+// touched once every `batch` operations.
+//
+// Since `pool + budgets + live == limit` at all times, `live` never exceeds
+// the limit. When the pool and the budget of the shard are both empty, the
+// budgets of all shards are drained under a lock, and the caller keeps one
+// of the units drained before the rest goes to the pool, where another
+// thread could take it first. Acquiring then only fails when `limit` objects
+// are alive, or when the missing units are in transit inside another
+// `acquire` or `release`: out of the pool or a budget, not yet added to the
+// other, for a few instructions.
+
+// ================================================================================================
+// Sharded count
+// ================================================================================================
+
+// the shard of the calling thread: threads are spread round robin
+inline size_t shard_of_this_thread(size_t shards)
+{
+  static std::atomic<size_t> next{0};
+  thread_local size_t const id = next.fetch_add(1, std::memory_order_relaxed);
+  return id % shards;
+}
+
+template <uint32_t limit>
+class ShardedCount
+{
+  static constexpr size_t shards = 64;
+  // a quarter of the limit is spread over the shards in batches
+  static constexpr uint32_t batch = std::max<uint32_t>(1, limit / 4 / shards);
+
+  struct alignas(64) Shard
+  {
+    std::atomic<uint32_t> budget{0};
+  };
+
+  Shard shard[shards];
+  alignas(64) std::atomic<uint32_t> pool{limit};
+  std::mutex reclaim_mutex;
+
+  // up to `n` units from the pool
+  uint32_t take(uint32_t n)
+  {
+    uint32_t p = pool.load(std::memory_order_relaxed);
+    while (p > 0 && !pool.compare_exchange_weak(
+                        p, p - std::min(n, p), std::memory_order_relaxed
+                    ))
+    {
+    }
+    return std::min(n, p);
+  }
+
+  // every budget back into the pool, but for one unit kept for the caller;
+  // false when the budgets and the pool are all empty
+  bool reclaim_one()
+  {
+    std::lock_guard lock{reclaim_mutex};
+    uint32_t freed = 0;
+    for (auto& s : shard)
+      freed += s.budget.exchange(0, std::memory_order_relaxed);
+    if (freed == 0)
+      return take(1) == 1;
+    if (freed > 1)
+      pool.fetch_add(freed - 1, std::memory_order_relaxed);
+    return true;
+  }
+
+public:
+  ShardedCount() = default;
+  ShardedCount(ShardedCount const&) = delete;
+  ShardedCount& operator=(ShardedCount const&) = delete;
+
+  // one more live object, if under the limit
+  bool acquire()
+  {
+    auto& budget = shard[shard_of_this_thread(shards)].budget;
+    uint32_t b = budget.load(std::memory_order_relaxed);
+    while (b > 0)
+      if (budget.compare_exchange_weak(b, b - 1, std::memory_order_relaxed))
+        return true;
+
+    uint32_t got = take(batch);
+    if (got == 0)
+      return reclaim_one();
+    if (got > 1)
+      budget.fetch_add(got - 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // one live object less
+  void release()
+  {
+    auto& budget = shard[shard_of_this_thread(shards)].budget;
+    uint32_t b = budget.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (b > 2 * batch)
+    {
+      // keep one batch; `reclaim_one` may have drained the budget meanwhile
+      while (b > batch && !budget.compare_exchange_weak(
+                              b, batch, std::memory_order_relaxed
+                          ))
+      {
+      }
+      if (b > batch)
+        pool.fetch_add(b - batch, std::memory_order_relaxed);
+    }
+  }
+
+  // exact when no other thread is acquiring or releasing
+  uint32_t live() const
+  {
+    uint32_t free = pool.load(std::memory_order_relaxed);
+    for (auto const& s : shard)
+      free += s.budget.load(std::memory_order_relaxed);
+    return limit - free;
+  }
+};
+
+// ================================================================================================
+// CRTP base
+// ================================================================================================
+
+// Same use as `LimitNoOfInstances`, for types created and destroyed from many
+// threads at a high rate: `struct Task : ShardedLimitNoOfInstances<Task, 64>`.
+template <typename ToBeLimited, uint32_t maxInstance>
+struct ShardedLimitNoOfInstances
+{
+  static inline ShardedCount<maxInstance> cnt;
+
+  ShardedLimitNoOfInstances()
+  {
+    if (!cnt.acquire())
+      throw std::logic_error("Too many instances");
+  }
+
+  // a copy is one more instance too
+  ShardedLimitNoOfInstances(ShardedLimitNoOfInstances const&)
+      : ShardedLimitNoOfInstances()
+  {
+  }
+
+  ~ShardedLimitNoOfInstances()
+  {
+    cnt.release();
+  }
+};
@@ -5,12 +5,44 @@
  *
  * additional reading about template: http://www.vishalchovatiya.com/c-template-a-quick-uptodate-look/
  */
+#include <algorithm>
 #include <atomic>
-#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <exception>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "et_parallel.h"
+#include "limit_instances.h"
+#include "printer_sink.h"
+
+// the checks of the tests below, kept in release builds unlike `assert`
+#define CHECK(cond) ((cond) ? void(0) : check_failed(#cond, __FILE__, __LINE__))
+
+[[noreturn]] void check_failed(char const* cond, char const* file, int line)
+{
+  std::cerr << file << ':' << line << ": check failed: " << cond << std::endl;
+  std::abort();
+}
 
 /**
  * 1. Static polymorphism
@@ -103,6 +135,114 @@ struct Two : LimitNoOfInstances<Two, 2>
 template <typename T, uint32_t maxNoOfInstance>
 std::atomic<uint32_t> LimitNoOfInstances<T, maxNoOfInstance>::cnt(0);
 
+// d) a pool of exactly `maxInstance` slots for the instances created by `new`
+//
+// The slots are one static array, allocated once; `new` and `delete` pop and
+// push a slot on a lock-free free list, O(1) without calling `malloc`. Freed
+// slots are reused first, while still in cache. `new` beyond the limit throws
+// like the constructor. A type derived from `ToBeLimited` has another size
+// and goes to the global heap (deleting it through a base pointer needs a
+// virtual destructor, as usual, for `delete` to get that size).
+template <typename ToBeLimited, uint32_t maxInstance>
+struct PooledInstances : LimitNoOfInstances<ToBeLimited, maxInstance>
+{
+  static void* operator new(size_t size)
+  {
+    if (size != sizeof(ToBeLimited))
+      return ::operator new(size);
+    void* p = slab().pop();
+    if (!p)
+      throw std::logic_error("Too many instances");
+    return p;
+  }
+
+  static void operator delete(void* p, size_t size)
+  {
+    if (size != sizeof(ToBeLimited))
+      return ::operator delete(p);
+    slab().push(p);
+  }
+
+private:
+  // Free slots are linked by index through `next`. `head` holds the first
+  // free index in its low half and, in its high half, a count of pops: a
+  // slot popped and pushed back between the load and the CAS of another pop
+  // changes the count, so the CAS fails instead of linking a stale `next`.
+  class Slab
+  {
+    static constexpr uint32_t none = maxInstance;
+    static constexpr size_t slot = sizeof(ToBeLimited);
+
+    alignas(ToBeLimited) std::byte storage[maxInstance * slot];
+    std::atomic<uint32_t> next[maxInstance];
+    std::atomic<uint64_t> head{0};
+
+  public:
+    Slab()
+    {
+      for (uint32_t i = 0; i < maxInstance; ++i)
+        next[i].store(i + 1, std::memory_order_relaxed);
+    }
+
+    void* pop()
+    {
+      uint64_t h = head.load(std::memory_order_acquire);
+      for (;;)
+      {
+        uint32_t i = static_cast<uint32_t>(h);
+        if (i == none)
+          return nullptr;
+        uint64_t popped = ((h >> 32) + 1) << 32 |
+                          next[i].load(std::memory_order_relaxed);
+        if (head.compare_exchange_weak(
+                h, popped, std::memory_order_acquire, std::memory_order_acquire
+            ))
+          return storage + i * slot;
+      }
+    }
+
+    void push(void* p)
+    {
+      auto* b = static_cast<std::byte*>(p);
+      uint32_t i = static_cast<uint32_t>((b - storage) / slot);
+      uint64_t h = head.load(std::memory_order_relaxed);
+      uint64_t pushed;
+      do
+      {
+        next[i].store(static_cast<uint32_t>(h), std::memory_order_relaxed);
+        pushed = (h & 0xffffffff00000000ull) | i;
+      } while (!head.compare_exchange_weak(
+          h, pushed, std::memory_order_release, std::memory_order_relaxed
+      ));
+    }
+  };
+
+  static Slab& slab()
+  {
+    static Slab s;
+    return s;
+  }
+};
+
+// e) derived struct, allocated from its pool
+struct Particle : PooledInstances<Particle, 1024>
+{
+  double x, y, z;
+};
+
+// not the size of a slot: allocated on the heap, still counted
+struct HeavyParticle : Particle
+{
+  double mass;
+};
+
+// f) the same limit for types created from many threads at once: a sharded
+// count where most constructions touch a cache line of their own thread
+// only, see limit_instances.h and crtp_limit_bench
+struct Three : ShardedLimitNoOfInstances<Three, 3>
+{
+};
+
 void test2()
 {
   Two _2_0, _2_1;
@@ -115,6 +255,89 @@ void test2()
   {
     std::cout << e.what() << std::endl;
   }
+
+  // three threads, one object each at a time: never over the limit, so
+  // never refused, wherever the free units are
+  std::atomic<int> refused{0};
+  std::vector<std::thread> three;
+  for (int t = 0; t < 3; ++t)
+    three.emplace_back([&refused] {
+      for (int i = 0; i < 100000; ++i)
+        try
+        {
+          Three keep;
+        }
+        catch (std::logic_error const&)
+        {
+          ++refused;
+        }
+    });
+  for (auto& t : three)
+    t.join();
+  CHECK(refused == 0);
+  try
+  {
+    Three _3_0, _3_1, _3_2, _3_3;
+    CHECK(false);
+  }
+  catch (std::exception& e)
+  {
+    std::cout << e.what() << std::endl;
+  }
+  CHECK(Three::cnt.live() == 0);
+
+  // a freed slot is the next one handed out
+  auto* p = new Particle;
+  delete p;
+  auto* q = new Particle;
+  CHECK(p == q);
+  delete q;
+
+  // the sized `operator delete` hands another size back to the heap
+  auto* heavy = new HeavyParticle;
+  CHECK(Particle::cnt == 1);
+  delete heavy;
+  CHECK(Particle::cnt == 0);
+
+  // all 1024 slots, then one too many, from several threads at once
+  std::vector<std::unique_ptr<Particle>> particles(1024);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t)
+    threads.emplace_back([&particles, t] {
+      for (int round = 0; round < 1000; ++round)
+        for (size_t i = t; i < particles.size(); i += 4)
+        {
+          particles[i].reset(); // before, not after, the next one
+          particles[i] = std::make_unique<Particle>();
+        }
+    });
+  for (auto& t : threads)
+    t.join();
+  CHECK(Particle::cnt == 1024);
+  std::vector<Particle*> slots;
+  for (auto const& x : particles)
+    slots.push_back(x.get());
+  std::sort(slots.begin(), slots.end());
+  CHECK(std::adjacent_find(slots.begin(), slots.end()) == slots.end());
+
+  try
+  {
+    auto* more = new Particle; // the pool is empty
+    delete more;
+    CHECK(false);
+  }
+  catch (std::exception& e)
+  {
+    std::cout << e.what() << std::endl;
+  }
+
+  // and every slot comes back
+  particles.clear();
+  CHECK(Particle::cnt == 0);
+  particles.resize(1024);
+  for (auto& x : particles)
+    x = std::make_unique<Particle>();
+  particles.clear();
 }
 
 /**
@@ -157,39 +380,351 @@ public:
   {
     return *std::next(actual().begin(), i);
   }
+
+  /**
+   * bulk algorithms, also derived from `begin()` / `end()` only
+   *
+   * contiguous storage (`DynArray`) of at least
+   * `et::parallel_policy().threshold` elements is split into chunks run on
+   * the pool of et_parallel.h, once enabled by `et::set_threads`; anything
+   * else runs on the calling thread.
+   * `f`, `op` and `pred` may then be called concurrently, and `op` has to be
+   * associative: partial results are combined in order.
+   */
+  template <typename F>
+  void for_each(F f)
+  {
+    run(actual().begin(), [&](size_t, auto first, auto last) {
+      std::for_each(first, last, f);
+    });
+  }
+
+  // in place: every element becomes `f(element)`
+  template <typename F>
+  void transform(F f)
+  {
+    run(actual().begin(), [&](size_t, auto first, auto last) {
+      std::transform(first, last, first, f);
+    });
+  }
+
+  template <typename V>
+  void fill(V const& value)
+  {
+    run(actual().begin(), [&](size_t, auto first, auto last) {
+      std::fill(first, last, value);
+    });
+  }
+
+  template <typename U, typename Op = std::plus<>>
+  U reduce(U init, Op op = {}) const
+  {
+    std::vector<U> partial(chunks<decltype(actual().begin())>().count);
+    run(actual().begin(), [&](size_t c, auto first, auto last) {
+      // the first chunk starts from `init`, the others from their first element
+      U acc = c == 0 ? init : static_cast<U>(*first++);
+      for (; first != last; ++first)
+        acc = op(acc, *first);
+      partial[c] = acc;
+    });
+
+    U acc = partial[0];
+    for (size_t c = 1; c < partial.size(); ++c)
+      acc = op(acc, partial[c]);
+    return acc;
+  }
+
+  template <typename Pred>
+  size_t count_if(Pred pred) const
+  {
+    std::vector<size_t> partial(chunks<decltype(actual().begin())>().count);
+    run(actual().begin(), [&](size_t c, auto first, auto last) {
+      partial[c] = std::count_if(first, last, pred);
+    });
+    return std::reduce(partial.begin(), partial.end(), size_t{0});
+  }
+
+private:
+  struct Chunks
+  {
+    size_t count;
+    size_t length;
+  };
+
+  // Chunk boundaries fall on cache lines, so no two threads write into the
+  // same line; a few chunks per thread even out the load.
+  template <typename It>
+  Chunks chunks() const
+  {
+    size_t const n = size();
+    if constexpr (std::contiguous_iterator<It>)
+    {
+      auto const& policy = et::parallel_policy();
+      if (policy.pool && n >= policy.threshold)
+      {
+        constexpr size_t granularity =
+            std::max<size_t>(1, 64 / sizeof(std::iter_value_t<It>));
+        size_t const count = policy.pool->size() * et::chunks_per_thread;
+        size_t length = (n + count - 1) / count;
+        length = (length + granularity - 1) / granularity * granularity;
+        return {(n + length - 1) / length, length};
+      }
+    }
+    return {1, n};
+  }
+
+  // calls `f(c, first, last)` for every chunk `c` of the range at `begin`
+  template <typename It, typename F>
+  void run(It begin, F const& f) const
+  {
+    size_t const n = size();
+    Chunks const c = chunks<It>();
+    auto chunk = [&](size_t i) {
+      size_t first = i * c.length;
+      size_t last = std::min(n, first + c.length);
+      f(i, std::next(begin, first), std::next(begin, last));
+    };
+
+    if (c.count == 1)
+      chunk(0);
+    else
+      et::parallel_policy().pool->run(c.count, chunk);
+  }
 };
 
 // b)
+// tag of the constructor that leaves the elements default-initialized, i.e.
+// indeterminate for `int`, `double`... (cf. `std::make_unique_for_overwrite`)
+struct for_overwrite_t
+{
+};
+inline constexpr for_overwrite_t for_overwrite{};
+
 template <typename T>
 class DynArray : public Container<DynArray<T>>
 {
-  size_t m_size;
-  std::unique_ptr<T[]> m_data;
+  // Storage comes from `malloc` so that it can be `realloc`ed: for a `T` that
+  // may be moved with its bytes, growing is one `realloc`, which often
+  // extends the block in place, instead of allocate + move + destroy.
+  // Trivially copyable types are the ones the language guarantees for.
+  static constexpr bool relocatable = std::is_trivially_copyable_v<T>;
+  static_assert(alignof(T) <= alignof(std::max_align_t));
+
+  size_t m_size = 0;
+  size_t m_capacity = 0;
+  T* m_data = nullptr;
+
+  void relocate(size_t capacity)
+  {
+    if (capacity > std::numeric_limits<size_t>::max() / sizeof(T))
+      throw std::length_error("DynArray too long");
+    if constexpr (relocatable)
+    {
+      void* p = std::realloc(m_data, capacity * sizeof(T));
+      if (!p)
+        throw std::bad_alloc();
+      m_data = static_cast<T*>(p);
+    }
+    else
+    {
+      T* p = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+      if (!p)
+        throw std::bad_alloc();
+      // like `std::vector`: copied unless moving cannot throw (or there is no
+      // copy), so that a throwing element leaves the array as it was
+      try
+      {
+        if constexpr (std::is_nothrow_move_constructible_v<T> ||
+                      !std::is_copy_constructible_v<T>)
+          std::uninitialized_move_n(m_data, m_size, p);
+        else
+          std::uninitialized_copy_n(m_data, m_size, p);
+      }
+      catch (...)
+      {
+        std::free(p);
+        throw;
+      }
+      std::destroy_n(m_data, m_size);
+      std::free(m_data);
+      m_data = p;
+    }
+    m_capacity = capacity;
+  }
+
+  // geometric growth: n push_backs relocate O(log n) times
+  void grow_to(size_t n)
+  {
+    if (n > m_capacity)
+      relocate(std::max(n, 2 * m_capacity));
+  }
 
 public:
+  DynArray() = default;
+
+  // value-initialized (zeroed) elements
   DynArray(size_t s)
-      : m_size{s}, m_data{std::make_unique<T[]>(s)}
   {
+    reserve(s);
+    try
+    {
+      std::uninitialized_value_construct_n(m_data, s);
+    }
+    catch (...)
+    {
+      std::free(m_data); // no destructor for a constructor that throws
+      throw;
+    }
+    m_size = s;
+  }
+
+  // default-initialized elements, to be overwritten: no zeroing pass
+  DynArray(size_t s, for_overwrite_t)
+  {
+    reserve(s);
+    try
+    {
+      std::uninitialized_default_construct_n(m_data, s);
+    }
+    catch (...)
+    {
+      std::free(m_data);
+      throw;
+    }
+    m_size = s;
+  }
+
+  DynArray(DynArray&& other) noexcept
+      : m_size{std::exchange(other.m_size, 0)},
+        m_capacity{std::exchange(other.m_capacity, 0)},
+        m_data{std::exchange(other.m_data, nullptr)}
+  {
+  }
+
+  DynArray& operator=(DynArray&& other) noexcept
+  {
+    DynArray(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  ~DynArray()
+  {
+    std::destroy_n(m_data, m_size);
+    std::free(m_data);
+  }
+
+  void swap(DynArray& other) noexcept
+  {
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_data, other.m_data);
+  }
+
+  size_t capacity() const
+  {
+    return m_capacity;
+  }
+
+  void reserve(size_t n)
+  {
+    if (n > m_capacity)
+      relocate(n);
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args)
+  {
+    if (m_size == m_capacity)
+    {
+      // `args` may refer to an element: build before relocating
+      T t(std::forward<Args>(args)...);
+      grow_to(m_size + 1);
+      T& x = *std::construct_at(m_data + m_size, std::move(t));
+      ++m_size;
+      return x;
+    }
+    // counted once it exists: a constructor that throws adds nothing
+    T& x = *std::construct_at(m_data + m_size, std::forward<Args>(args)...);
+    ++m_size;
+    return x;
+  }
+
+  void push_back(T const& x)
+  {
+    emplace_back(x);
+  }
+
+  void push_back(T&& x)
+  {
+    emplace_back(std::move(x));
+  }
+
+  // new elements are value-initialized
+  void resize(size_t n)
+  {
+    grow_to(n);
+    if (n > m_size)
+      std::uninitialized_value_construct(m_data + m_size, m_data + n);
+    else
+      std::destroy(m_data + n, m_data + m_size);
+    m_size = n;
+  }
+
+  // new elements are default-initialized
+  void resize(size_t n, for_overwrite_t)
+  {
+    grow_to(n);
+    if (n > m_size)
+      std::uninitialized_default_construct(m_data + m_size, m_data + n);
+    else
+      std::destroy(m_data + n, m_data + m_size);
+    m_size = n;
   }
 
   T* begin()
   {
-    return m_data.get();
+    return m_data;
   }
 
   const T* begin() const
   {
-    return m_data.get();
+    return m_data;
   }
 
   T* end()
   {
-    return m_data.get() + m_size;
+    return m_data + m_size;
   }
 
   const T* end() const
   {
-    return m_data.get() + m_size;
+    return m_data + m_size;
+  }
+};
+
+// an element that fails on demand; its move may throw, so it is copied
+struct Fragile
+{
+  static inline int copies_left = 0;
+  static inline bool construction_fails = false;
+  int v = 7;
+
+  Fragile()
+  {
+    if (construction_fails)
+      throw std::runtime_error("construction");
+  }
+
+  Fragile(Fragile const& other)
+      : v{other.v}
+  {
+    if (copies_left-- <= 0)
+      throw std::runtime_error("copy");
+  }
+
+  Fragile(Fragile&& other)
+      : Fragile(other)
+  {
   }
 };
 
@@ -198,7 +733,86 @@ void test3()
   DynArray<int> arr(10);
   arr.front() = 2;
   arr[2] = 5;
-  assert(arr.size() == 10);
+  CHECK(arr.size() == 10);
+
+  // the same calls, sequential and then split across 4 threads
+  DynArray<long> big(1 << 20);
+  for (size_t threads : {1, 4})
+  {
+    et::set_threads(threads);
+    big.fill(1);
+    big.transform([](long x) { return 3 * x; });
+    big.for_each([](long& x) { x -= 1; });
+    CHECK(big.reduce(10L) == 10 + 2 * (1L << 20));
+    CHECK(big.reduce(1.0, [](double a, double b) { return std::max(a, b); }) ==
+           2.0);
+    big[7] = 0;
+    CHECK(big.count_if([](long x) { return x == 2; }) == (1 << 20) - 1);
+  }
+  et::set_threads(1);
+
+  // grown one element at a time, and a buffer that is written before read
+  DynArray<std::string> names;
+  for (int i = 0; i < 100; ++i)
+    names.push_back(std::to_string(i));
+  names.push_back(names.front()); // may relocate while reading an element
+  CHECK(names.size() == 101 && names.back() == "0" && names[99] == "99");
+  CHECK(names.capacity() < 2 * 101);
+
+  DynArray<double> buf(1000, for_overwrite);
+  buf.fill(0.5);
+  buf.resize(4000, for_overwrite);
+  buf.resize(5000);
+  CHECK(buf[999] == 0.5 && buf[4999] == 0.0 && buf.capacity() >= 5000);
+  buf.resize(10);
+  CHECK(buf.size() == 10 && buf.back() == 0.5);
+
+  // an element whose copy throws: growing fails, the array stays as it was
+  DynArray<Fragile> fragile(4);
+  Fragile::copies_left = 2;
+  try
+  {
+    fragile.reserve(100);
+    CHECK(false);
+  }
+  catch (std::runtime_error const&)
+  {
+  }
+  CHECK(fragile.size() == 4 && fragile.capacity() == 4 && fragile[3].v == 7);
+
+  // and whose construction throws: nothing leaks, nothing is added
+  Fragile::construction_fails = true;
+  try
+  {
+    DynArray<Fragile> never(3);
+    CHECK(false);
+  }
+  catch (std::runtime_error const&)
+  {
+  }
+  Fragile::copies_left = 4;
+  fragile.reserve(8);
+  try
+  {
+    fragile.emplace_back();
+    CHECK(false);
+  }
+  catch (std::runtime_error const&)
+  {
+  }
+  CHECK(fragile.size() == 4 && fragile.capacity() == 8);
+  Fragile::construction_fails = false;
+
+  // a size whose bytes do not fit in `size_t`
+  try
+  {
+    buf.reserve(std::numeric_limits<size_t>::max() / 4);
+    CHECK(false);
+  }
+  catch (std::length_error const&)
+  {
+  }
+  CHECK(buf.size() == 10 && buf.back() == 0.5);
 }
 
 /**
@@ -206,26 +820,65 @@ void test3()
  */
 
 // a)
+// Either an `std::ostream`, or a `Sink` of printer_sink.h: the line is then
+// formatted into a buffer of the printer and handed to the sink whole, which
+// batches its writes, on another thread for an `AsyncSink`.
 template <typename ConcretePrinter>
 class Printer
 {
-  std::ostream& m_stream;
+  std::ostream* m_stream = nullptr;
+  Sink* m_sink = nullptr;
+  std::optional<LineBuffer> m_line; // with a sink only
 
 public:
   Printer(std::ostream& s)
-      : m_stream{s}
+      : m_stream{&s}
+  {
+  }
+
+  Printer(Sink& s)
+      : m_sink{&s}, m_line{std::in_place}
+  {
+  }
+
+  // a copy starts with a line of its own, or the unfinished line of the
+  // original would be written twice
+  Printer(Printer const& other)
+      : m_stream{other.m_stream}, m_sink{other.m_sink}
   {
+    if (m_sink)
+      m_line.emplace();
+  }
+
+  Printer& operator=(Printer const&) = delete;
+
+  // an unfinished line still goes out
+  ~Printer()
+  {
+    if (m_sink && !m_line->empty())
+      m_sink->write(m_line->view());
   }
 
   ConcretePrinter& print(auto&& t)
   {
-    m_stream << t;
+    if (m_sink)
+      m_line->append(t);
+    else
+      *m_stream << t;
     return static_cast<ConcretePrinter&>(*this);
   }
 
   ConcretePrinter& println(auto&& t)
   {
-    m_stream << t << std::endl;
+    if (m_sink)
+    {
+      m_line->append(t);
+      m_line->append('\n');
+      m_sink->write(m_line->view());
+      m_line->clear();
+    }
+    else
+      *m_stream << t << std::endl;
     return static_cast<ConcretePrinter&>(*this);
   }
 };
@@ -245,7 +898,12 @@ struct ColorPrinter : Printer<ColorPrinter>
   {
   }
 
-  ColorPrinter& SetConsoleColor(Color c)
+  ColorPrinter(Sink& s)
+      : Printer{s}
+  {
+  }
+
+  ColorPrinter& SetConsoleColor(Color /* c */)
   {
     // ...
     return *this;
@@ -258,6 +916,66 @@ void test4()
       .print("Hello")
       .SetConsoleColor(ColorPrinter::Color::red)
       .println("Printer");
+
+  // the same chain through a buffered sink, then from several threads
+  // through an asynchronous one
+  std::cout.flush();
+  {
+    FdSink out;
+    ColorPrinter(out)
+        .print("Hello ")
+        .SetConsoleColor(ColorPrinter::Color::blue)
+        .print(42)
+        .print(' ')
+        .println(0.5);
+  }
+  {
+    AsyncSink out;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+      threads.emplace_back([&out, t] {
+        ColorPrinter p(out);
+        for (int i = 0; i < 3; ++i)
+          p.print("thread ").print(t).print(" line ").println(i);
+      });
+    for (auto& t : threads)
+      t.join();
+  }
+
+  // copying a printer does not copy its unfinished line
+  struct Lines : Sink
+  {
+    std::string text;
+    void write(std::string_view line) override { text += line; }
+    void flush() override {}
+  } lines;
+  {
+    ColorPrinter p(lines);
+    p.print("half ");
+    ColorPrinter copy = p;
+    copy.println("other");
+  }
+  CHECK(lines.text == "other\nhalf ");
+
+  // `flush` returns while another thread keeps the sink thread busy
+  {
+    int fd = ::open("/dev/null", O_WRONLY);
+    CHECK(fd >= 0);
+    {
+      AsyncSink out(fd, 64);
+      std::atomic<bool> stop{false};
+      std::thread producer([&] {
+        ColorPrinter p(out);
+        while (!stop.load(std::memory_order_relaxed))
+          p.print("busy line ").println(1);
+      });
+      for (int i = 0; i < 100; ++i)
+        out.flush();
+      stop = true;
+      producer.join();
+    }
+    ::close(fd);
+  }
 }
 
 /**
@@ -273,6 +991,25 @@ struct Animal
     return std::make_unique<Specific>(static_cast<Specific&>(*this));
   }
 
+  // Owns the object, not its memory: destroying the handle runs the
+  // destructor of `Specific` and leaves the storage to the arena.
+  using ArenaHandle = std::unique_ptr<Animal, void (*)(Animal*)>;
+
+  // The copy is constructed in storage of `arena`. With a
+  // `std::pmr::monotonic_buffer_resource`, cloning many objects is a bump of
+  // a pointer each, into a few contiguous blocks, and the whole batch is
+  // freed at once by `release()` or the destruction of the arena, once the
+  // handles are gone.
+  ArenaHandle clone(std::pmr::memory_resource& arena)
+  {
+    std::pmr::polymorphic_allocator<> alloc{&arena};
+    Specific* copy =
+        alloc.new_object<Specific>(static_cast<Specific&>(*this));
+    return ArenaHandle(copy, [](Animal* a) {
+      std::destroy_at(static_cast<Specific*>(a));
+    });
+  }
+
 protected: // forcing Animal class to be inherited
   Animal() = default;
   Animal(const Animal&) = default;
@@ -314,14 +1051,36 @@ void test5()
 
   who_am_i(&d2);
   who_am_i(&c1);
+
+  // a snapshot into an arena, then thrown away in one go
+  std::pmr::monotonic_buffer_resource arena;
+  {
+    auto dog = d1.clone(arena);
+    auto cat = c1.clone(arena);
+  }
+  arena.release();
+
+  struct Fish : Animal<Fish>
+  {
+    int fins = 2;
+  };
+
+  Fish f;
+  std::pmr::vector<Animal<Fish>::ArenaHandle> school(&arena);
+  school.reserve(100000);
+  for (int i = 0; i < 100000; ++i)
+    school.push_back(f.clone(arena));
+  CHECK(static_cast<Fish&>(*school.back()).fins == 2);
+  school.clear();
+  arena.release();
 }
 
 int main()
 {
-  // test1();
-  // test2();
-  // test3();
-  // test4();
+  test1();
+  test2();
+  test3();
+  test4();
   test5();
 
   return 0;
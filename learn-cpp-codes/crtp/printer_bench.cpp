@@ -0,0 +1,130 @@
+/**
+ * @file:	printer_bench.cpp
+ * @author:	Jacob Xie
+ * @date:	2026/10/18 00:40:00 Sunday
+ * @brief:	lines per second of the `Printer` backends
+ **/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench.h"
+#include "printer_sink.h"
+
+// Every case writes the same lines, `"value " << i << " x " << x` with an
+// integer and a double, to /dev/null (or the file given), so that the cost
+// of formatting and of system calls shows rather than the one of a disk:
+//
+// - endl:  `std::ostream` and `std::endl`, the way `Printer` used to print
+// - '\n':  `std::ostream` without the flush per line
+// - fd:    `LineBuffer` and `FdSink`, one `write(2)` per 64 KiB
+// - async: `LineBuffer` and `AsyncSink`, from 1 and 4 producer threads
+
+double x_of(size_t i) { return static_cast<double>(i) * 0.25; }
+
+// median of `reps` runs, in seconds
+template <typename F>
+double median_of(int reps, F&& f)
+{
+  bench::Options opt;
+  opt.warmup = 0.0;
+  opt.min_sample = 0.0; // one run per sample
+  opt.samples = static_cast<size_t>(reps);
+  return bench::measure(f, opt).median;
+}
+
+void report(char const* name, size_t lines, double seconds)
+{
+  std::cout << std::setw(12) << name << std::setw(12)
+            << static_cast<double>(lines) / seconds * 1e-6 << '\n';
+}
+
+void ostream_lines(char const* path, size_t lines, bool endl, int reps)
+{
+  double const seconds = median_of(reps, [&] {
+    std::ofstream out(path);
+    for (size_t i = 0; i < lines; ++i)
+    {
+      out << "value " << i << " x " << x_of(i);
+      if (endl)
+        out << std::endl;
+      else
+        out << '\n';
+    }
+    out.flush();
+  });
+  report(endl ? "endl" : "'\\n'", lines, seconds);
+}
+
+void sink_lines(Sink& sink, size_t first, size_t last)
+{
+  LineBuffer line;
+  for (size_t i = first; i < last; ++i)
+  {
+    line.append("value ");
+    line.append(i);
+    line.append(" x ");
+    line.append(x_of(i));
+    line.append('\n');
+    sink.write(line.view());
+    line.clear();
+  }
+}
+
+// usage: crtp_printer_bench [lines] [output file]
+int main(int argc, char** argv)
+{
+  size_t const lines =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+  char const* path = argc > 2 ? argv[2] : "/dev/null";
+  int const reps = 5;
+
+  std::cout << lines << " lines to " << path
+            << ", million lines/s (median of " << reps << ")\n"
+            << std::fixed << std::setprecision(2);
+
+  ostream_lines(path, lines, true, reps);
+  ostream_lines(path, lines, false, reps);
+
+  int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return 1;
+  // every run writes the file again from its start
+  double fd_seconds = median_of(reps, [&] {
+    ::lseek(fd, 0, SEEK_SET);
+    FdSink sink(fd);
+    sink_lines(sink, 0, lines);
+    sink.flush();
+  });
+  report("fd", lines, fd_seconds);
+
+  for (size_t producers : {1, 4})
+  {
+    double seconds = median_of(reps, [&] {
+      ::lseek(fd, 0, SEEK_SET);
+      AsyncSink sink(fd);
+      std::vector<std::thread> threads;
+      for (size_t p = 0; p < producers; ++p)
+        threads.emplace_back([&, p] {
+          sink_lines(
+              sink, lines * p / producers, lines * (p + 1) / producers
+          );
+        });
+      for (auto& th : threads)
+        th.join();
+      sink.flush();
+    });
+    report(producers == 1 ? "async x1" : "async x4", lines, seconds);
+  }
+
+  ::close(fd);
+  return 0;
+}
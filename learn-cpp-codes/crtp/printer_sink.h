@@ -0,0 +1,372 @@
+/**
+ * @file:	printer_sink.h
+ * @author:	Jacob Xie
+ * @date:	2026/10/18 00:10:00 Sunday
+ * @brief:	buffered and asynchronous line sinks for the CRTP `Printer`
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <unistd.h>
+
+// `Printer` writing to a `std::ostream` with `std::endl` pays a formatted
+// iostream call per value and a flush, i.e. a `write(2)`, per line. With a
+// sink instead, the printer formats each line itself into a `LineBuffer`
+// (numbers with `std::to_chars`) and hands it over whole:
+//
+// - `FdSink` copies lines into a large buffer and writes it to a file
+//   descriptor once full, one `write(2)` for thousands of lines
+// - `AsyncSink` lets any number of threads push lines into a lock-free queue;
+//   a background thread drains it into an `FdSink`, so a producer never
+//   waits on I/O
+//
+// Output reaches the descriptor on `flush()` or destruction of the sink, not
+// at every line: flush `std::cout` before writing to fd 1 through a sink and
+// the sink before writing through `std::cout`, or lines come out of order.
+
+// ================================================================================================
+// Line buffer
+// ================================================================================================
+
+class LineBuffer
+{
+  std::string m_buf;
+
+public:
+  LineBuffer()
+  {
+    m_buf.reserve(256);
+  }
+
+  // Numbers go through `std::to_chars`, in their shortest round-trip form
+  // (`0.1`, `1e+100`), not iostream's 6 significant digits. Types that are
+  // neither numbers nor strings fall back to `operator<<`.
+  template <typename T>
+  void append(T const& t)
+  {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char>)
+      m_buf.push_back(std::is_same_v<U, bool> ? char('0' + t) : t);
+    else if constexpr (std::is_arithmetic_v<U>)
+    {
+      char tmp[32];
+      auto r = std::to_chars(tmp, tmp + sizeof(tmp), t);
+      m_buf.append(tmp, r.ptr);
+    }
+    else if constexpr (std::is_convertible_v<T const&, std::string_view>)
+      m_buf.append(std::string_view(t));
+    else
+    {
+      std::ostringstream os;
+      os << t;
+      m_buf.append(os.view());
+    }
+  }
+
+  void clear()
+  {
+    m_buf.clear();
+  }
+
+  bool empty() const
+  {
+    return m_buf.empty();
+  }
+
+  std::string_view view() const
+  {
+    return m_buf;
+  }
+};
+
+// ================================================================================================
+// Sinks
+// ================================================================================================
+
+struct Sink
+{
+  virtual ~Sink() = default;
+
+  // `line` includes its '\n'; it is copied before returning
+  virtual void write(std::string_view line) = 0;
+  virtual void flush() = 0;
+};
+
+// Not thread-safe: one printer or one thread at a time.
+class FdSink final : public Sink
+{
+  int m_fd;
+  std::unique_ptr<char[]> m_buf;
+  size_t m_capacity;
+  size_t m_used = 0;
+
+  void write_all(char const* p, size_t n)
+  {
+    while (n > 0)
+    {
+      ssize_t w = ::write(m_fd, p, n);
+      if (w < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        throw std::system_error(errno, std::generic_category(), "write");
+      }
+      p += w;
+      n -= static_cast<size_t>(w);
+    }
+  }
+
+public:
+  explicit FdSink(int fd = STDOUT_FILENO, size_t capacity = size_t{1} << 16)
+      : m_fd{fd},
+        m_buf{std::make_unique_for_overwrite<char[]>(capacity)},
+        m_capacity{capacity}
+  {
+  }
+
+  FdSink(FdSink const&) = delete;
+  FdSink& operator=(FdSink const&) = delete;
+
+  ~FdSink() override
+  {
+    try
+    {
+      flush();
+    }
+    catch (...)
+    {
+    }
+  }
+
+  void write(std::string_view line) override
+  {
+    if (line.size() > m_capacity - m_used)
+    {
+      flush();
+      // longer than the whole buffer: straight through
+      if (line.size() >= m_capacity)
+        return write_all(line.data(), line.size());
+    }
+    std::memcpy(m_buf.get() + m_used, line.data(), line.size());
+    m_used += line.size();
+  }
+
+  void flush() override
+  {
+    size_t n = std::exchange(m_used, 0);
+    write_all(m_buf.get(), n);
+  }
+};
+
+// Producers reserve consecutive slots of a bounded ring and copy their line
+// into them; the sink thread takes slots in order. A slot carries a sequence
+// number (Vyukov's bounded queue): `pos` when free for position `pos`,
+// `pos + 1` once filled, `pos + slots` once taken again, so neither side ever
+// locks. A line spanning k slots is reserved with one CAS on the tail after
+// checking that its last slot is free, which the single consumer freeing in
+// order makes sufficient; lines of different threads never interleave, unless
+// a line is longer than the whole ring and has to be cut.
+//
+// A full ring makes producers wait (yield) for the sink thread. An idle sink
+// thread flushes what it has, then sleeps until a producer wakes it; a busy
+// one flushes as soon as it is past the position a `flush()` waits for.
+class AsyncSink final : public Sink
+{
+  struct alignas(64) Slot
+  {
+    std::atomic<uint64_t> seq;
+    uint32_t len;
+    char bytes[128 - sizeof(std::atomic<uint64_t>) - sizeof(uint32_t)];
+  };
+
+  static constexpr size_t payload = sizeof(Slot::bytes);
+
+  size_t m_slots;
+  std::unique_ptr<Slot[]> m_ring;
+  alignas(64) std::atomic<uint64_t> m_tail{0}; // next position to reserve
+  alignas(64) std::atomic<uint64_t> m_flushed{0}; // positions written out
+  std::atomic<uint64_t> m_flush_wanted{0}; // up to where `flush()` waits
+  std::atomic<uint32_t> m_wake{0};
+  std::atomic<bool> m_sleeping{false};
+  std::atomic<bool> m_stop{false};
+  FdSink m_out;
+  std::thread m_thread;
+
+  Slot& slot(uint64_t pos)
+  {
+    return m_ring[pos & (m_slots - 1)];
+  }
+
+  void wake()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // only the first producer to see the sink thread asleep makes the call
+    if (m_sleeping.load(std::memory_order_relaxed) &&
+        m_sleeping.exchange(false, std::memory_order_relaxed))
+    {
+      m_wake.fetch_add(1, std::memory_order_relaxed);
+      m_wake.notify_one();
+    }
+  }
+
+  // `k` slots, `k <= m_slots`, starting at the returned position
+  uint64_t reserve(uint64_t k)
+  {
+    uint64_t pos = m_tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      uint64_t last = pos + k - 1;
+      auto lag = static_cast<int64_t>(
+          slot(last).seq.load(std::memory_order_acquire) - last
+      );
+      if (lag == 0)
+      {
+        if (m_tail.compare_exchange_weak(
+                pos, pos + k, std::memory_order_relaxed
+            ))
+          return pos;
+      }
+      else if (lag < 0) // full: not taken yet from the previous lap
+      {
+        wake();
+        std::this_thread::yield();
+        pos = m_tail.load(std::memory_order_relaxed);
+      }
+      else // reserved by another producer meanwhile
+        pos = m_tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  void publish(uint64_t head)
+  {
+    m_out.flush();
+    m_flushed.store(head, std::memory_order_release);
+    m_flushed.notify_all();
+  }
+
+  void consume()
+  {
+    uint64_t head = 0;
+    int idle = 0;
+    for (;;)
+    {
+      Slot& s = slot(head);
+      if (s.seq.load(std::memory_order_acquire) == head + 1)
+      {
+        m_out.write({s.bytes, s.len});
+        s.seq.store(head + m_slots, std::memory_order_release);
+        ++head;
+        idle = 0;
+        uint64_t wanted = m_flush_wanted.load(std::memory_order_relaxed);
+        if (head >= wanted && wanted > m_flushed.load(std::memory_order_relaxed))
+          publish(head);
+        continue;
+      }
+
+      // nothing ready: give the producers a moment, so that a burst is not
+      // written out a few lines at a time, then write out what we have and
+      // sleep
+      if (++idle < 64)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      idle = 0;
+      publish(head);
+      if (m_stop.load(std::memory_order_acquire) &&
+          m_tail.load(std::memory_order_acquire) == head)
+        return;
+
+      uint32_t w = m_wake.load(std::memory_order_relaxed);
+      m_sleeping.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (s.seq.load(std::memory_order_acquire) != head + 1 &&
+          !m_stop.load(std::memory_order_acquire))
+        m_wake.wait(w, std::memory_order_relaxed);
+      m_sleeping.store(false, std::memory_order_relaxed);
+    }
+  }
+
+public:
+  // `slots` is rounded up to a power of two, 128 bytes each
+  explicit AsyncSink(int fd = STDOUT_FILENO, size_t slots = 4096)
+      : m_slots{std::bit_ceil(std::max<size_t>(slots, 2))},
+        m_ring{std::make_unique<Slot[]>(m_slots)},
+        m_out{fd}
+  {
+    for (uint64_t i = 0; i < m_slots; ++i)
+      m_ring[i].seq.store(i, std::memory_order_relaxed);
+    m_thread = std::thread([this] { consume(); });
+  }
+
+  AsyncSink(AsyncSink const&) = delete;
+  AsyncSink& operator=(AsyncSink const&) = delete;
+
+  // everything written before is written out
+  ~AsyncSink() override
+  {
+    m_stop.store(true, std::memory_order_release);
+    m_wake.fetch_add(1, std::memory_order_relaxed);
+    m_wake.notify_one();
+    m_thread.join();
+  }
+
+  // thread-safe, lock-free unless the ring is full
+  void write(std::string_view line) override
+  {
+    while (!line.empty())
+    {
+      uint64_t k = std::min<uint64_t>(
+          (line.size() + payload - 1) / payload, m_slots
+      );
+      uint64_t pos = reserve(k);
+      for (uint64_t i = 0; i < k; ++i)
+      {
+        Slot& s = slot(pos + i);
+        s.len = static_cast<uint32_t>(std::min(line.size(), payload));
+        std::memcpy(s.bytes, line.data(), s.len);
+        line.remove_prefix(s.len);
+        s.seq.store(pos + i + 1, std::memory_order_release);
+      }
+      wake();
+    }
+  }
+
+  // returns once every line written before the call is in the descriptor
+  void flush() override
+  {
+    uint64_t target = m_tail.load(std::memory_order_acquire);
+    uint64_t wanted = m_flush_wanted.load(std::memory_order_relaxed);
+    while (wanted < target && !m_flush_wanted.compare_exchange_weak(
+                                  wanted, target, std::memory_order_relaxed
+                              ))
+    {
+    }
+    for (;;)
+    {
+      uint64_t done = m_flushed.load(std::memory_order_acquire);
+      if (done >= target)
+        return;
+      m_wake.fetch_add(1, std::memory_order_relaxed);
+      m_wake.notify_one();
+      m_flushed.wait(done, std::memory_order_acquire);
+    }
+  }
+};
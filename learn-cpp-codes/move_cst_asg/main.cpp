@@ -1,25 +1,12 @@
-#include <chrono>
-#include <iostream>
-
 #include "arr_cp.h"
 #include "arr_mv.h"
+#include "bench/bench.h"
 
-class Timer
-{
-  private:
-  using Clock = std::chrono::high_resolution_clock;
-  using Second = std::chrono::duration<double, std::ratio<1>>;
-
-  std::chrono::time_point<Clock> m_beg{Clock::now()};
-
-  public:
-  void reset() { m_beg = Clock::now(); }
-
-  double elapsed() const
-  {
-    return std::chrono::duration_cast<Second>(Clock::now() - m_beg).count();
-  }
-};
+// 1e7 elements, down from the 1e8 (`10e7`) of the single timed run this
+// replaced: every sample builds and clones the array again, and at 1e8 one
+// iteration of the copy version takes about a second and holds three arrays
+// of 400 MB at once, so 50 samples would take minutes
+constexpr int g_length = 10'000'000;
 
 arr_cp::DynamicArray<int> cloneArrayAndDouble(const arr_cp::DynamicArray<int>& arr)
 {
@@ -39,35 +26,31 @@ arr_mv::DynamicArray<int> cloneArrayAndDouble(const arr_mv::DynamicArray<int>& a
   return dbl;
 }
 
-int main(int argc, char const* argv[])
+BENCHMARK_ELEMENTS(copy_semantics, g_length)
 {
-  Timer t;
-
-  arr_cp::DynamicArray<int> arr1(10e7);
+  arr_cp::DynamicArray<int> arr1(g_length);
 
   for (int i = 0; i < arr1.getLength(); ++i)
     arr1[i] = i;
 
   arr1 = cloneArrayAndDouble(arr1);
 
-  const double t1 = t.elapsed();
-
-  std::cout << "Copy semantics time consumed: " << t1 << std::endl;
-
-  t.reset();
+  bench::do_not_optimize(arr1[arr1.getLength() - 1]);
+}
 
-  arr_mv::DynamicArray<int> arr2(10e7);
+BENCHMARK_ELEMENTS(move_semantics, g_length)
+{
+  arr_mv::DynamicArray<int> arr2(g_length);
 
   for (int i = 0; i < arr2.getLength(); ++i)
     arr2[i] = i;
 
   arr2 = cloneArrayAndDouble(arr2);
 
-  const double t2 = t.elapsed();
-
-  std::cout << "Move semantics time consumed: " << t2 << std::endl;
-
-  std::cout << "t2/t1 = " << t2 / t1 << std::endl;
+  bench::do_not_optimize(arr2[arr2.getLength() - 1]);
+}
 
-  return 0;
+int main(int argc, char* argv[])
+{
+  return bench::run(argc, argv);
 }
@@ -1,28 +1,11 @@
 #include <algorithm>
 #include <array>
-#include <chrono>  // std::chrono
 #include <cstddef> // std::size_t
-#include <iostream>
 #include <numeric> // std::iota
 
-const int g_arrayElements{10000};
-
-class Timer
-{
-private:
-  using Clock = std::chrono::steady_clock;
-  using Second = std::chrono::duration<double, std::ratio<1>>;
-
-  std::chrono::time_point<Clock> m_beg{Clock::now()};
-
-public:
-  void reset() { m_beg = Clock::now(); }
+#include "bench/bench.h"
 
-  double elapsed() const
-  {
-    return std::chrono::duration_cast<Second>(Clock::now() - m_beg).count();
-  }
-};
+const int g_arrayElements{10000};
 
 void sortArray(std::array<int, g_arrayElements>& array)
 {
@@ -45,23 +28,40 @@ void sortArray(std::array<int, g_arrayElements>& array)
   }
 }
 
-int main(int argc, char const* argv[])
+// Every iteration sorts a fresh copy of the reversed array; `copy` times the
+// copy alone. This changes the workload of `std_sort`: the single timed run
+// this replaced gave `std::sort` the array the selection sort had already
+// sorted.
+const std::array<int, g_arrayElements> g_reversed = []
 {
-
   std::array<int, g_arrayElements> array;
   std::iota(array.rbegin(), array.rend(), 1);
+  return array;
+}();
 
-  Timer t;
+BENCHMARK_ELEMENTS(copy, g_arrayElements)
+{
+  auto array{g_reversed};
+  bench::do_not_optimize(array);
+}
 
+BENCHMARK_ELEMENTS(selection_sort, g_arrayElements)
+{
+  auto array{g_reversed};
+  bench::do_not_optimize(array);
   sortArray(array);
+  bench::do_not_optimize(array);
+}
 
-  std::cout << "Time elapsed: " << t.elapsed() << " seconds\n";
-
-  t.reset();
-
+BENCHMARK_ELEMENTS(std_sort, g_arrayElements)
+{
+  auto array{g_reversed};
+  bench::do_not_optimize(array);
   std::sort(array.begin(), array.end());
+  bench::do_not_optimize(array);
+}
 
-  std::cout << "Time elapsed: " << t.elapsed() << " seconds\n";
-
-  return 0;
+int main(int argc, char* argv[])
+{
+  return bench::run(argc, argv);
 }